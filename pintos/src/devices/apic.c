@@ -0,0 +1,297 @@
+#include "devices/apic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Interface to the local APIC and I/O APIC, which QEMU emulates
+   in addition to the 8259A PICs and 8254 PIT.  Refer to
+   [IA32-v3a] chapter 8 "Advanced Programmable Interrupt
+   Controller" and [82093AA] for details.
+
+   Compared to the PIC, acknowledging an interrupt is a single
+   store to a memory-mapped register rather than one or two
+   `outb' instructions, and the local APIC timer counts at the
+   bus clock rate rather than the PIT's 1.19 MHz, so it can be
+   programmed much more finely.  The I/O APIC is also what other
+   CPUs would need to receive device interrupts.
+
+   The 8259A PICs remain the default.  apic_init() switches over
+   to the APICs only if "-apic" was given and the CPU has a local
+   APIC. */
+
+/* Model-specific register holding the local APIC's physical
+   base address. */
+#define MSR_APIC_BASE 0x1b
+#define MSR_APIC_BASE_ENABLE 0x800
+
+/* Default physical address of the first I/O APIC.  Real
+   firmware reports it in the ACPI MADT, but QEMU always puts it
+   here. */
+#define IOAPIC_PHYS 0xfec00000
+
+/* Kernel virtual addresses at which the APICs' registers are
+   mapped, in the otherwise unused top page table of the kernel
+   address space. */
+#define LAPIC_VADDR ((void *) 0xfffff000)
+#define IOAPIC_VADDR ((void *) 0xffffe000)
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task priority. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_LVT_TIMER 0x320   /* Timer local vector table entry. */
+#define LAPIC_TIMER_ICR 0x380   /* Timer initial count. */
+#define LAPIC_TIMER_CCR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DCR 0x3e0   /* Timer divide configuration. */
+
+#define LAPIC_SVR_ENABLE  0x100         /* APIC software enable. */
+#define LAPIC_LVT_MASKED  0x10000       /* Interrupt masked. */
+#define LAPIC_LVT_PERIODIC 0x20000      /* Periodic timer mode. */
+#define LAPIC_TIMER_DIV16 0x3           /* Divide bus clock by 16. */
+
+/* I/O APIC registers.  The I/O APIC is programmed indirectly:
+   write a register index to IOREGSEL, then access IOWIN. */
+#define IOAPIC_REGSEL   0x00
+#define IOAPIC_WIN      0x10
+#define IOAPIC_VER      0x01            /* Version register index. */
+#define IOAPIC_REDTBL(PIN) (0x10 + 2 * (PIN)) /* Redirection entry. */
+#define IOAPIC_MASKED   0x10000         /* Redirection entry masked. */
+
+/* Interrupt vectors. */
+#define TIMER_VEC 0x20                  /* Same as the PIT's IRQ 0. */
+#define SPURIOUS_VEC 0xff
+
+/* Number of timer ticks to calibrate the local APIC timer over. */
+#define CALIBRATE_TICKS 10
+
+/* True once apic_init() has switched over to the APICs. */
+static bool enabled;
+
+/* Local APIC timer counts per timer tick. */
+static uint32_t counts_per_tick;
+
+bool apic_requested;
+
+static intr_handler_func spurious_interrupt;
+static void map_mmio (void *vaddr, uintptr_t paddr);
+static uint32_t lapic_read (int reg);
+static void lapic_write (int reg, uint32_t value);
+static uint32_t ioapic_read (int reg);
+static void ioapic_write (int reg, uint32_t value);
+
+/* Returns true if the CPU has a local APIC,
+   according to CPUID. */
+static bool
+cpu_has_apic (void)
+{
+  uint32_t eax = 1, ebx, ecx = 0, edx;
+
+  /* See [IA32-v2a] "CPUID": bit 9 of EDX for leaf 1. */
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+  return (edx & (1 << 9)) != 0;
+}
+
+/* Reads model-specific register MSR.  See [IA32-v2b] "RDMSR". */
+static uint64_t
+rdmsr (uint32_t msr)
+{
+  uint64_t value;
+  asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+  return value;
+}
+
+/* If "-apic" was given and the CPU supports it, switches
+   external interrupts from the 8259A PICs to the I/O APIC and
+   the timer interrupt from the PIT to the local APIC timer.
+   Must be called with interrupts on, after timer_calibrate(),
+   because the local APIC timer is calibrated against the PIT's
+   ticks. */
+void
+apic_init (void) 
+{
+  uint32_t lapic_phys, start, elapsed, dest;
+  int64_t tick;
+  int pin, max_pin;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (!apic_requested)
+    return;
+  if (!cpu_has_apic ())
+    {
+      printf ("APIC: not present, using 8259A PIC\n");
+      return;
+    }
+
+  lapic_phys = rdmsr (MSR_APIC_BASE) & PTE_ADDR;
+  map_mmio (LAPIC_VADDR, lapic_phys);
+  map_mmio (IOAPIC_VADDR, IOAPIC_PHYS);
+
+  /* Software-enable the local APIC and accept all priorities. */
+  intr_register_int (SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+                     "APIC Spurious");
+  lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VEC);
+  lapic_write (LAPIC_TPR, 0);
+
+  /* Count down the local APIC timer for CALIBRATE_TICKS PIT
+     ticks, starting just after a tick. */
+  lapic_write (LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | TIMER_VEC);
+  tick = timer_ticks ();
+  while (timer_ticks () == tick)
+    continue;
+  start = UINT32_MAX;
+  lapic_write (LAPIC_TIMER_ICR, start);
+  tick = timer_ticks ();
+  while (timer_elapsed (tick) < CALIBRATE_TICKS)
+    continue;
+  elapsed = start - lapic_read (LAPIC_TIMER_CCR);
+  counts_per_tick = elapsed / CALIBRATE_TICKS;
+
+  /* Now switch over, with interrupts off so that no interrupt
+     can arrive half-way. */
+  intr_disable ();
+  intr_use_apic ();
+
+  /* Route ISA IRQs 1 and 3...15 to vectors 0x21...0x2f on this
+     CPU, edge-triggered and active-high, as the PICs did.  Pin 0
+     carries the PICs' own output and the PIT's IRQ 0 is wired to
+     pin 2; both stay masked, because the local APIC timer
+     replaces the PIT. */
+  dest = lapic_read (LAPIC_ID) & 0xff000000;
+  max_pin = (ioapic_read (IOAPIC_VER) >> 16) & 0xff;
+  for (pin = 0; pin <= max_pin; pin++) 
+    {
+      if (pin >= 1 && pin < 16 && pin != 2)
+        {
+          ioapic_write (IOAPIC_REDTBL (pin) + 1, dest);
+          ioapic_write (IOAPIC_REDTBL (pin), 0x20 + pin);
+        }
+      else
+        ioapic_write (IOAPIC_REDTBL (pin), IOAPIC_MASKED);
+    }
+
+  /* Start the periodic local APIC timer on the PIT's vector, so
+     that timer_interrupt() keeps receiving the ticks. */
+  apic_timer_periodic ();
+  enabled = true;
+
+  intr_enable ();
+  printf ("APIC: enabled, local APIC timer at %'"PRIu32" counts/tick.\n",
+          counts_per_tick);
+}
+
+/* Returns true if interrupts are delivered by the APICs. */
+bool
+apic_enabled (void) 
+{
+  return enabled;
+}
+
+/* Signals end of interrupt to the local APIC. */
+void
+apic_eoi (void) 
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Returns the number of local APIC timer counts in a timer
+   tick, or 0 if the local APIC timer is not in use. */
+uint32_t
+apic_timer_counts_per_tick (void) 
+{
+  return enabled ? counts_per_tick : 0;
+}
+
+/* Starts the local APIC timer interrupting once per timer
+   tick. */
+void
+apic_timer_periodic (void) 
+{
+  lapic_write (LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | TIMER_VEC);
+  lapic_write (LAPIC_TIMER_ICR, counts_per_tick);
+}
+
+/* Starts a one-shot countdown of COUNT local APIC timer counts,
+   which interrupts once when it reaches zero and then stays
+   at zero. */
+void
+apic_timer_oneshot (uint32_t count) 
+{
+  ASSERT (count > 0);
+
+  lapic_write (LAPIC_LVT_TIMER, TIMER_VEC);
+  lapic_write (LAPIC_TIMER_ICR, count);
+}
+
+/* Returns the local APIC timer's current count, which is 0 once
+   a one-shot countdown has expired. */
+uint32_t
+apic_timer_count (void) 
+{
+  return lapic_read (LAPIC_TIMER_CCR);
+}
+
+/* Spurious interrupts from the local APIC need no EOI. */
+static void
+spurious_interrupt (struct intr_frame *f UNUSED) 
+{
+}
+
+/* Maps the page at physical address PADDR, which lies outside
+   RAM, to kernel virtual address VADDR with caching disabled,
+   as memory-mapped registers require.  The mapping goes into
+   init_page_dir, from which every process page directory copies
+   its kernel half. */
+static void
+map_mmio (void *vaddr, uintptr_t paddr) 
+{
+  uint32_t *pde = init_page_dir + pd_no (vaddr);
+  uint32_t *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0 && (paddr & PGMASK) == 0);
+
+  if (*pde == 0)
+    *pde = pde_create (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt (*pde);
+  pt[pt_no (vaddr)] = paddr | PTE_PCD | PTE_PWT | PTE_W | PTE_P;
+
+  asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
+
+/* Local APIC register access. */
+static uint32_t
+lapic_read (int reg) 
+{
+  return *(volatile uint32_t *) ((uint8_t *) LAPIC_VADDR + reg);
+}
+
+static void
+lapic_write (int reg, uint32_t value) 
+{
+  *(volatile uint32_t *) ((uint8_t *) LAPIC_VADDR + reg) = value;
+}
+
+/* I/O APIC register access. */
+static uint32_t
+ioapic_read (int reg) 
+{
+  volatile uint32_t *base = IOAPIC_VADDR;
+  base[IOAPIC_REGSEL / 4] = reg;
+  return base[IOAPIC_WIN / 4];
+}
+
+static void
+ioapic_write (int reg, uint32_t value) 
+{
+  volatile uint32_t *base = IOAPIC_VADDR;
+  base[IOAPIC_REGSEL / 4] = reg;
+  base[IOAPIC_WIN / 4] = value;
+}
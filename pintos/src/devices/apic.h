@@ -0,0 +1,20 @@
+#ifndef DEVICES_APIC_H
+#define DEVICES_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Use the local APIC and I/O APIC instead of the 8259A PICs
+   and the 8254 PIT?  Controlled by kernel command-line option
+   "-apic". */
+extern bool apic_requested;
+
+void apic_init (void);
+bool apic_enabled (void);
+void apic_eoi (void);
+uint32_t apic_timer_counts_per_tick (void);
+void apic_timer_periodic (void);
+void apic_timer_oneshot (uint32_t count);
+uint32_t apic_timer_count (void);
+
+#endif /* devices/apic.h */
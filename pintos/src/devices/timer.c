@@ -3,11 +3,16 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/apic.h"
 #include "devices/pit.h"
+#include "devices/rtc.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
-  
+#include "threads/tsc.h"
+#include "threads/workqueue.h"
+
 /* See [8254] for hardware details of the 8254 timer chip. */
 
 #if TIMER_FREQ < 19
@@ -20,15 +25,85 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* If true, the idle thread stops the periodic timer interrupt
+   and instead programs a one-shot countdown that expires at the
+   next sleeping thread's deadline.  Controlled by kernel
+   command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Sub-tick one-shot state.  While the earliest high-resolution
+   deadline falls before the next tick, the timer runs in
+   one-shot mode instead, interrupting at each such deadline and
+   then at the tick itself, after which it goes back to periodic
+   mode. */
+static bool hr_oneshot;         /* Sub-tick one-shot programmed? */
+static uint32_t hr_to_tick;     /* Counts from its expiry to the tick. */
+
+/* State of the current tickless idle period, if any. */
+static int64_t oneshot_ticks;      /* Ticks covered, or 0 if periodic. */
+static uint32_t oneshot_count;     /* Count that was programmed. */
+static uint32_t oneshot_first;     /* Counts until the first tick. */
+
+/* Tickless idle statistics. */
+static long long idle_periods;  /* # of one-shot idle periods. */
+static long long idle_skipped;  /* # of ticks without an interrupt. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* High-resolution clock.  timer_calibrate() measures the TSC
+   frequency against the PIT, after which timer_ns() converts the
+   TSC into nanoseconds since boot.  The clock is in step with
+   timer_ticks() as of calibration; later the two may drift apart
+   slightly. */
+#define NS_PER_SEC 1000000000
+#define CALIBRATE_TICKS 5       /* Ticks to measure the TSC over. */
+static uint32_t tsc_khz;        /* TSC frequency, 0 if not calibrated. */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+static uint64_t tsc_base;       /* TSC at calibration. */
+static int64_t ns_base;         /* Clock at calibration. */
+static int64_t realtime_base;   /* Wall-clock time when timer_ns() was 0. */
+
+/* Threads blocked in a high-resolution sleep, ordered by TSC
+   deadline.  Expired at each timer interrupt, including the
+   one-shot interrupts programmed for deadlines that fall between
+   ticks.  Only touched with interrupts off. */
+struct hr_sleeper
+  {
+    struct list_elem elem;      /* Element in hr_sleepers. */
+    uint64_t deadline;          /* TSC value at which to wake. */
+    struct thread *thread;      /* Sleeping thread. */
+  };
+static struct list hr_sleepers;
+
+/* Cost of the timer interrupt handler, in CPU cycles. */
+static struct timer_intr_stats intr_stats;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void idle_catch_up (int64_t elapsed);
+static uint64_t ns_to_cycles (int64_t ns);
+static int64_t cycles_to_ns (uint64_t cycles);
+static void hr_sleep_until (uint64_t deadline);
+static void hr_expire (uint64_t now);
+static uint32_t hr_next_count (void);
+static void hr_arm (void);
+static void hr_start (uint32_t count, uint32_t to_tick);
+static void clock_periodic (void);
+static void clock_oneshot (uint32_t count);
+static uint32_t clock_remaining (void);
+static bool clock_expired (void);
+static uint32_t clock_counts_per_tick (void);
+static uint32_t clock_max_count (void);
+static bool hr_deadline_less (const struct list_elem *,
+                              const struct list_elem *, void *aux);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -37,13 +112,18 @@ timer_init (void)
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+  list_init (&hr_sleepers);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays
+   before the TSC is calibrated, and then the TSC frequency, used
+   by the high-resolution clock. */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  uint64_t start;
+  int64_t tick;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -64,6 +144,42 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Count TSC cycles over CALIBRATE_TICKS ticks, starting just
+     after a tick. */
+  tick = timer_ticks ();
+  while (timer_ticks () == tick)
+    continue;
+  start = rdtsc ();
+  tick = timer_ticks ();
+  while (timer_elapsed (tick) < CALIBRATE_TICKS)
+    continue;
+  tsc_base = rdtsc ();
+  ns_base = (tick + CALIBRATE_TICKS) * (NS_PER_SEC / TIMER_FREQ);
+  tsc_khz = (tsc_base - start) * TIMER_FREQ / CALIBRATE_TICKS / 1000;
+  tsc_per_tick = ns_to_cycles (NS_PER_SEC / TIMER_FREQ);
+  realtime_base = (int64_t) rtc_get_time () * NS_PER_SEC - ns_base;
+  printf ("TSC: %'"PRIu32" kHz.\n", tsc_khz);
+}
+
+/* Returns the number of nanoseconds since the OS booted, as
+   measured by the TSC.  Returns 0 until timer_calibrate() has
+   run.  Never decreases. */
+int64_t
+timer_ns (void) 
+{
+  if (tsc_khz == 0)
+    return 0;
+  return ns_base + cycles_to_ns (rdtsc () - tsc_base);
+}
+
+/* Returns the wall-clock time in nanoseconds since the Unix
+   epoch, according to the real-time clock read at calibration
+   and the TSC since. */
+int64_t
+timer_realtime_ns (void) 
+{
+  return realtime_base + timer_ns ();
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -89,23 +205,19 @@ timer_elapsed (int64_t then)
 void
 timer_sleep (int64_t ticks) 
 {
-  /*int64_t start = timer_ticks();
-    thread_sleep(ticks);*/
-  //printf("%i\n", ticks);
-  //  ticks = ticks - 10 > 0 ? ticks - 1  : 0;
-  ASSERT (intr_get_level () == INTR_ON);
-  intr_disable();
-  ticks = ticks - 1 > 0 ? ticks - 1 : 0;
   int64_t start = timer_ticks ();
-  struct thread *t = thread_current();
-  //printf("Thread Sleeping: %s\n", t->name);
-  t->time_sleep = ticks;
-  //printf("Sleeping %s with %i ticks.\n", t->name, t->time_sleep);
-  thread_sleep();
-  intr_enable();
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  thread_sleep (start + ticks);
+  intr_set_level (old_level);
 }
 
-/* Sleeps for approximately MS milliseconds.  Interrupts must be
+/* Sleeps for at least MS milliseconds.  Interrupts must be
    turned on. */
 void
 timer_msleep (int64_t ms) 
@@ -113,7 +225,7 @@ timer_msleep (int64_t ms)
   real_time_sleep (ms, 1000);
 }
 
-/* Sleeps for approximately US microseconds.  Interrupts must be
+/* Sleeps for at least US microseconds.  Interrupts must be
    turned on. */
 void
 timer_usleep (int64_t us) 
@@ -121,7 +233,7 @@ timer_usleep (int64_t us)
   real_time_sleep (us, 1000 * 1000);
 }
 
-/* Sleeps for approximately NS nanoseconds.  Interrupts must be
+/* Sleeps for at least NS nanoseconds.  Interrupts must be
    turned on. */
 void
 timer_nsleep (int64_t ns) 
@@ -173,14 +285,193 @@ void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Tickless: %lld idle periods, %lld ticks skipped\n",
+            idle_periods, idle_skipped);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic timer
+   interrupt by a one-shot countdown that expires at the tick of
+   the earliest sleeping thread's or delayed work item's deadline,
+   or as far ahead as the timer can count: a few ticks for the
+   16-bit PIT, far longer for the 32-bit local APIC timer. */
+void
+timer_idle_enter (void) 
+{
+  uint32_t per_tick = clock_counts_per_tick ();
+  int64_t delta;
+  uint64_t count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks != 0 || hr_oneshot)
+    return;
+
+  delta = thread_next_wakeup ();
+  if (workqueue_next_deadline () < delta)
+    delta = workqueue_next_deadline ();
+  if (!list_empty (&hr_sleepers))
+    {
+      /* Wake up at a tick shortly before the earliest deadline,
+         at which timer_interrupt() programs a one-shot for the
+         deadline itself. */
+      struct hr_sleeper *s = list_entry (list_front (&hr_sleepers),
+                                         struct hr_sleeper, elem);
+      uint64_t now = rdtsc ();
+      int64_t hr_tick = ticks;
+      if (s->deadline > now)
+        hr_tick += (s->deadline - now) / tsc_per_tick;
+      if (hr_tick < delta)
+        delta = hr_tick;
+    }
+  delta -= ticks;
+  if (delta <= 1)
+    return;
+  if (delta > clock_max_count () / per_tick)
+    delta = clock_max_count () / per_tick;
+
+  /* Part of the current tick has already elapsed, so count from
+     the periodic counter's current value to keep the ticks in
+     phase. */
+  oneshot_first = clock_remaining ();
+  if (oneshot_first == 0 || oneshot_first > per_tick)
+    oneshot_first = per_tick;
+  count = oneshot_first + (delta - 1) * per_tick;
+  if (count > clock_max_count ())
+    {
+      delta--;
+      count -= per_tick;
+    }
+
+  oneshot_ticks = delta;
+  oneshot_count = count;
+  idle_periods++;
+  clock_oneshot (count);
+}
+
+/* Called at the start of every external interrupt.  If an
+   interrupt other than the timer woke the CPU during a tickless
+   idle period, catches up the ticks that elapsed and restores the
+   periodic timer interrupt, so that a thread woken by the
+   interrupt is preempted normally.  Whatever part of a tick had
+   elapsed is lost.
+
+   If the one-shot countdown has already expired, its interrupt
+   is either being handled or pending and timer_interrupt() does
+   the catching up instead. */
+void
+timer_idle_exit (void) 
+{
+  uint32_t per_tick = clock_counts_per_tick ();
+  uint32_t elapsed;
+
+  ASSERT (intr_context ());
+
+  if (oneshot_ticks == 0 || clock_expired ())
+    return;
+
+  elapsed = oneshot_count - clock_remaining ();
+  idle_catch_up (elapsed < oneshot_first
+                 ? 0 : 1 + (elapsed - oneshot_first) / per_tick);
+}
+
+/* Ends a tickless idle period during which ELAPSED ticks passed.
+   Restores the periodic timer interrupt and runs the per-tick
+   work for each tick that passed, so that sleepers, statistics,
+   and the scheduler see every tick. */
+static void
+idle_catch_up (int64_t elapsed) 
+{
+  oneshot_ticks = 0;
+  clock_periodic ();
+  if (elapsed > 1)
+    idle_skipped += elapsed - 1;
+  while (elapsed-- > 0)
+    {
+      ticks++;
+      thread_tick ();
+      workqueue_tick (ticks);
+    }
+}
+
+/* Copies the timer interrupt handler's cost statistics into
+   *STATS. */
+void
+timer_get_intr_stats (struct timer_intr_stats *stats) 
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = intr_stats;
+  intr_set_level (old_level);
+}
+
+/* Resets the timer interrupt handler's cost statistics. */
+void
+timer_reset_intr_stats (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  intr_stats.count = 0;
+  intr_stats.total_cycles = 0;
+  intr_stats.max_cycles = 0;
+  intr_set_level (old_level);
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *args)
 {
-  ticks++;
-  thread_tick ();
+  uint64_t start = rdtsc ();
+  uint64_t cycles;
+
+  if (!list_empty (&hr_sleepers))
+    hr_expire (start);
+
+  if (hr_oneshot && hr_to_tick != 0)
+    {
+      /* A high-resolution deadline before the tick.  Program the
+         next deadline, or else the tick. */
+      uint32_t count = hr_next_count ();
+      if (count > hr_to_tick)
+        count = hr_to_tick;
+      hr_start (count, hr_to_tick - count);
+    }
+  else
+    {
+      if (profile_enabled)
+        profile_tick (args);
+
+      if (oneshot_ticks != 0)
+        idle_catch_up (oneshot_ticks);
+      else
+        {
+          ticks++;
+          thread_tick ();
+          workqueue_tick (ticks);
+        }
+
+      /* Go back to periodic mode after a sub-tick one-shot,
+         unless another deadline falls within this tick. */
+      if (hr_oneshot)
+        {
+          uint32_t per_tick = clock_counts_per_tick ();
+          uint32_t count = hr_next_count ();
+          if (count < per_tick)
+            hr_start (count, per_tick - count);
+          else
+            {
+              hr_oneshot = false;
+              clock_periodic ();
+            }
+        }
+      else if (!list_empty (&hr_sleepers))
+        hr_arm ();
+    }
+
+  cycles = rdtsc () - start;
+  intr_stats.count++;
+  intr_stats.total_cycles += cycles;
+  if (cycles > intr_stats.max_cycles)
+    intr_stats.max_cycles = cycles;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -216,10 +507,26 @@ busy_wait (int64_t loops)
     barrier ();
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
+/* Sleep for at least NUM/DENOM seconds.  Once the TSC has been
+   calibrated, the thread sleeps in timer_sleep() for all but the
+   last tick or two and then in a high-resolution sleep until the
+   exact deadline. */
 static void
 real_time_sleep (int64_t num, int32_t denom) 
 {
+  if (tsc_khz != 0)
+    {
+      int64_t ns = num * (NS_PER_SEC / denom);
+      uint64_t deadline = rdtsc () + ns_to_cycles (ns);
+      int64_t whole_ticks = ns / (NS_PER_SEC / TIMER_FREQ);
+
+      ASSERT (intr_get_level () == INTR_ON);
+      if (whole_ticks > 1)
+        timer_sleep (whole_ticks - 1);
+      hr_sleep_until (deadline);
+      return;
+    }
+
   /* Convert NUM/DENOM seconds into timer ticks, rounding down.
           
         (NUM / DENOM) s          
@@ -244,12 +551,206 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
-/* Busy-wait for approximately NUM/DENOM seconds. */
+/* Busy-wait for approximately NUM/DENOM seconds, by the TSC if
+   it has been calibrated. */
 static void
 real_time_delay (int64_t num, int32_t denom)
 {
+  if (tsc_khz != 0)
+    {
+      uint64_t end = rdtsc () + ns_to_cycles (num * (NS_PER_SEC / denom));
+      while (rdtsc () < end)
+        asm volatile ("pause");
+      return;
+    }
+
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
   busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
+
+/* Converts NS nanoseconds to TSC cycles.  Splitting NS into
+   milliseconds and the remainder keeps the products from
+   overflowing. */
+static uint64_t
+ns_to_cycles (int64_t ns) 
+{
+  if (ns <= 0)
+    return 0;
+  return (uint64_t) ns / 1000000 * tsc_khz
+         + (uint64_t) ns % 1000000 * tsc_khz / 1000000;
+}
+
+/* Converts CYCLES TSC cycles to nanoseconds, likewise in two
+   parts. */
+static int64_t
+cycles_to_ns (uint64_t cycles) 
+{
+  return cycles / tsc_khz * 1000000
+         + cycles % tsc_khz * 1000000 / tsc_khz;
+}
+
+/* Blocks the running thread until the TSC reaches DEADLINE. */
+static void
+hr_sleep_until (uint64_t deadline) 
+{
+  struct hr_sleeper s;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (rdtsc () < deadline)
+    {
+      s.deadline = deadline;
+      s.thread = thread_current ();
+      list_insert_ordered (&hr_sleepers, &s.elem, hr_deadline_less, NULL);
+      if (list_front (&hr_sleepers) == &s.elem)
+        hr_arm ();
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Wakes every high-resolution sleeper whose deadline is no later
+   than NOW. */
+static void
+hr_expire (uint64_t now) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&hr_sleepers))
+    {
+      struct hr_sleeper *s = list_entry (list_front (&hr_sleepers),
+                                         struct hr_sleeper, elem);
+      if (s->deadline > now)
+        break;
+      list_pop_front (&hr_sleepers);
+      thread_unblock (s->thread);
+    }
+}
+
+/* Returns the number of timer counts until the earliest
+   high-resolution deadline, at least 1, or UINT32_MAX if there
+   is none or it is a tick or more away. */
+static uint32_t
+hr_next_count (void) 
+{
+  struct hr_sleeper *s;
+  uint64_t now, cycles;
+
+  if (list_empty (&hr_sleepers))
+    return UINT32_MAX;
+  s = list_entry (list_front (&hr_sleepers), struct hr_sleeper, elem);
+  now = rdtsc ();
+  if (s->deadline <= now)
+    return 1;
+  cycles = s->deadline - now;
+  if (cycles >= tsc_per_tick)
+    return UINT32_MAX;
+  return DIV_ROUND_UP (cycles * clock_counts_per_tick (), tsc_per_tick);
+}
+
+/* If the earliest high-resolution deadline comes before the
+   timer's next interrupt, reprograms the timer as a one-shot
+   that expires at the deadline.  Called with interrupts off,
+   when a sleeper joins the front of hr_sleepers and at each
+   periodic tick. */
+static void
+hr_arm (void) 
+{
+  uint32_t per_tick = clock_counts_per_tick ();
+  uint32_t left, count;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* During tickless idle, or if the one-shot has expired and its
+     interrupt is pending, the timer interrupt handles it. */
+  if (oneshot_ticks != 0 || (hr_oneshot && clock_expired ()))
+    return;
+
+  left = clock_remaining ();
+  if (!hr_oneshot && (left == 0 || left > per_tick))
+    left = per_tick;
+  count = hr_next_count ();
+  if (count < left)
+    hr_start (count, left + hr_to_tick - count);
+}
+
+/* Programs a sub-tick one-shot that expires in COUNT timer
+   counts, TO_TICK counts before the next tick. */
+static void
+hr_start (uint32_t count, uint32_t to_tick) 
+{
+  hr_oneshot = true;
+  hr_to_tick = to_tick;
+  clock_oneshot (count);
+}
+
+/* The timer is channel 0 of the PIT or, once apic_init() has
+   switched over, the local APIC timer.  Both count down from a
+   programmed value and interrupt on reaching zero, either once
+   or, in periodic mode, once per tick. */
+
+/* Puts the timer in periodic mode, interrupting at each tick. */
+static void
+clock_periodic (void) 
+{
+  if (apic_enabled ())
+    apic_timer_periodic ();
+  else
+    pit_configure_channel (0, 2, TIMER_FREQ);
+}
+
+/* Programs the timer to interrupt once, COUNT counts from now. */
+static void
+clock_oneshot (uint32_t count) 
+{
+  ASSERT (count <= clock_max_count ());
+
+  if (apic_enabled ())
+    apic_timer_oneshot (count);
+  else
+    pit_start_oneshot (count);
+}
+
+/* Returns the number of counts until the timer's next
+   interrupt.  Meaningless once a one-shot has expired. */
+static uint32_t
+clock_remaining (void) 
+{
+  return apic_enabled () ? apic_timer_count () : pit_read_count (0);
+}
+
+/* Returns true if a one-shot countdown has expired. */
+static bool
+clock_expired (void) 
+{
+  return apic_enabled () ? apic_timer_count () == 0 : pit_output_high (0);
+}
+
+/* Returns the number of timer counts in a tick. */
+static uint32_t
+clock_counts_per_tick (void) 
+{
+  return apic_enabled () ? apic_timer_counts_per_tick () : PIT_COUNTS_PER_TICK;
+}
+
+/* Returns the largest count that a one-shot can be programmed
+   with. */
+static uint32_t
+clock_max_count (void) 
+{
+  return apic_enabled () ? UINT32_MAX : UINT16_MAX;
+}
+
+/* Returns true if high-resolution sleeper A's deadline is before
+   B's. */
+static bool
+hr_deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+                  void *aux UNUSED) 
+{
+  const struct hr_sleeper *a = list_entry (a_, struct hr_sleeper, elem);
+  const struct hr_sleeper *b = list_entry (b_, struct hr_sleeper, elem);
+
+  return a->deadline < b->deadline;
+}
@@ -2,17 +2,25 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Tickless idle mode ("-tickless"). */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+/* High-resolution clock. */
+int64_t timer_ns (void);
+int64_t timer_realtime_ns (void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
@@ -26,4 +34,18 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/* Cost of the timer interrupt handler. */
+struct timer_intr_stats
+  {
+    int64_t count;              /* Number of interrupts handled. */
+    uint64_t total_cycles;      /* Total CPU cycles in the handler. */
+    uint64_t max_cycles;        /* Longest single invocation. */
+  };
+
+void timer_get_intr_stats (struct timer_intr_stats *);
+void timer_reset_intr_stats (void);
+
 #endif /* devices/timer.h */
@@ -5,7 +5,10 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -36,6 +39,10 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool loaded;                        /* DATA has been read from disk? */
+    struct semaphore load_sema;         /* Upped once DATA is loaded. */
+    struct rwlock data_lock;            /* Guards DATA and its sectors. */
+    struct rwlock lock;                 /* For inode_lock_*() callers. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -57,11 +64,67 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Guards open_inodes.  Lookups of already-open inodes, the common
+   case, share it. */
+static struct rwlock open_inodes_lock;
+
+/* Cache of `struct inode's. */
+static struct kmem_cache inode_cache;
+
+static kmem_ctor_func inode_ctor;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), 0,
+                   inode_ctor);
+}
+
+/* Constructs the `struct inode' at INODE_ by initializing its
+   locks, which are free again whenever it is closed for the last
+   time. */
+static void
+inode_ctor (void *inode_) 
+{
+  struct inode *inode = inode_;
+
+  rwlock_init (&inode->data_lock);
+  rwlock_init (&inode->lock);
+}
+
+/* Returns the open inode for SECTOR, reopened, or a null pointer
+   if SECTOR is not open.  OPEN_INODES_LOCK must be held.  The
+   inode may still be loading; see wait_loaded(). */
+static struct inode *
+find_open_inode (block_sector_t sector) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode_reopen (inode);
+    }
+  return NULL;
+}
+
+/* Waits until INODE's on-disk data has been read in by the
+   thread that opened it first, which does that without holding
+   open_inodes_lock.  Each waiter passes the semaphore on to the
+   next. */
+static void
+wait_loaded (struct inode *inode) 
+{
+  if (!inode->loaded)
+    {
+      sema_down (&inode->load_sema);
+      sema_up (&inode->load_sema);
+    }
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -111,33 +174,53 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  rwlock_release_read (&open_inodes_lock);
+  if (inode != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      wait_loaded (inode);
+      return inode;
+    }
+
+  /* Check again, since another thread may have opened it while
+     we did not hold the lock. */
+  rwlock_acquire_write (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  if (inode != NULL)
+    {
+      rwlock_release_write (&open_inodes_lock);
+      wait_loaded (inode);
+      return inode;
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_release_write (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
+  /* Initialize and publish the inode, then read it from disk
+     without holding the lock, so that opening and closing other
+     inodes need not wait for the read.  Anyone who finds it in
+     the meantime waits in wait_loaded(). */
   list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->loaded = false;
+  sema_init (&inode->load_sema, 0);
+  rwlock_release_write (&open_inodes_lock);
+
   block_read (fs_device, inode->sector, &inode->data);
+  inode->loaded = true;
+  sema_up (&inode->load_sema);
   return inode;
 }
 
@@ -145,8 +228,13 @@ inode_open (block_sector_t sector)
 struct inode *
 inode_reopen (struct inode *inode)
 {
+  /* Several threads may reopen the same inode at once. */
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -163,15 +251,38 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* Holders of other references may reopen INODE without taking
+     open_inodes_lock, so the count changes with interrupts off.
+     Dropping a reference other than the last only needs the
+     lock for reading. */
+  rwlock_acquire_read (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = inode->open_cnt == 1;
+  if (!last)
+    inode->open_cnt--;
+  intr_set_level (old_level);
+  rwlock_release_read (&open_inodes_lock);
+  if (!last)
+    return;
+
+  /* Release resources if this is still the last opener, now that
+     nobody can find INODE through open_inodes while we look. */
+  rwlock_acquire_write (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+  if (last)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_release_write (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -181,8 +292,10 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (&inode_cache, inode);
     }
+  else
+    rwlock_release_write (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -204,6 +317,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->data_lock);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -244,6 +358,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  rwlock_release_read (&inode->data_lock);
   free (bounce);
 
   return bytes_read;
@@ -262,8 +377,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
 
+  rwlock_acquire_write (&inode->data_lock);
   if (inode->deny_write_cnt)
-    return 0;
+    size = 0;
 
   while (size > 0) 
     {
@@ -312,6 +428,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+  rwlock_release_write (&inode->data_lock);
   free (bounce);
 
   return bytes_written;
@@ -322,8 +439,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->data_lock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->data_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +451,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->data_lock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->data_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +464,37 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Locks INODE for a sequence of operations that only read it,
+   such as a directory lookup.  Any number of threads may hold
+   this lock at once.  It is separate from the lock that
+   inode_read_at() and inode_write_at() take internally, so the
+   holder may still call them. */
+void
+inode_lock_read (struct inode *inode) 
+{
+  rwlock_acquire_read (&inode->lock);
+}
+
+/* Releases a lock taken by inode_lock_read(). */
+void
+inode_unlock_read (struct inode *inode) 
+{
+  rwlock_release_read (&inode->lock);
+}
+
+/* Locks INODE for a sequence of operations that modify it, such
+   as adding a directory entry, excluding every other holder of
+   inode_lock_read() or inode_lock_write(). */
+void
+inode_lock_write (struct inode *inode) 
+{
+  rwlock_acquire_write (&inode->lock);
+}
+
+/* Releases a lock taken by inode_lock_write(). */
+void
+inode_unlock_write (struct inode *inode) 
+{
+  rwlock_release_write (&inode->lock);
+}
@@ -19,5 +19,9 @@ off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+void inode_lock_read (struct inode *);
+void inode_unlock_read (struct inode *);
+void inode_lock_write (struct inode *);
+void inode_unlock_write (struct inode *);
 
 #endif /* filesys/inode.h */
@@ -60,6 +60,66 @@ byte_cnt (size_t bit_cnt)
   return sizeof (elem_type) * elem_cnt (bit_cnt);
 }
 
+/* Returns an elem_type with the bits for bit indexes FIRST
+   through LAST, inclusive, turned on.  FIRST and LAST must be in
+   the same element. */
+static inline elem_type
+range_mask (size_t first, size_t last) 
+{
+  elem_type high = (elem_type) -1 >> (ELEM_BITS - 1 - last % ELEM_BITS);
+  return high & ((elem_type) -1 << (first % ELEM_BITS));
+}
+
+/* Returns element E as it would be if every bit were inverted
+   when VALUE is false, so that the bits set to VALUE in E are
+   the set bits in the result. */
+static inline elem_type
+match (elem_type e, bool value) 
+{
+  return value ? e : ~e;
+}
+
+/* Returns the number of set bits in E. */
+static inline size_t
+popcount (elem_type e) 
+{
+  /* There is no libgcc in the kernel to back
+     __builtin_popcountl(), so use the classic bit-parallel
+     sum. */
+  e = e - ((e >> 1) & 0x55555555);
+  e = (e & 0x33333333) + ((e >> 2) & 0x33333333);
+  e = (e + (e >> 4)) & 0x0f0f0f0f;
+  return (e * 0x01010101) >> 24;
+}
+
+/* Returns the index of the first bit in B at or after START
+   that is set to VALUE, or B's size if there is none.  Looks at
+   a whole element at a time. */
+static size_t
+find_next (const struct bitmap *b, size_t start, bool value) 
+{
+  size_t idx = elem_idx (start);
+  size_t idx_cnt = elem_cnt (b->bit_cnt);
+  elem_type e;
+  size_t bit;
+
+  if (start >= b->bit_cnt)
+    return b->bit_cnt;
+
+  e = match (b->bits[idx], value) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (e == 0)
+    {
+      if (++idx >= idx_cnt)
+        return b->bit_cnt;
+      e = match (b->bits[idx], value);
+    }
+
+  /* The unused bits past the end of the last element read as
+     set when VALUE is false, so clamp to the end. */
+  bit = idx * ELEM_BITS + __builtin_ctzl (e);
+  return bit < b->bit_cnt ? bit : b->bit_cnt;
+}
+
 /* Returns a bit mask in which the bits actually used in the last
    element of B's bits are set to 1 and the rest are set to 0. */
 static inline elem_type
@@ -214,18 +274,41 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/* Sets the CNT bits starting at START in B to VALUE. */
+/* Sets the CNT bits starting at START in B to VALUE.
+   Each element is updated atomically, but not the group as a
+   whole. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t idx, last_idx, last;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  if (cnt == 0)
+    return;
+
+  last = start + cnt - 1;
+  idx = elem_idx (start);
+  last_idx = elem_idx (last);
+  if (idx == last_idx)
+    {
+      elem_type mask = range_mask (start, last);
+      if (value)
+        asm ("orl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+      return;
+    }
+
+  /* Partial first element, whole middle elements, partial last
+     element.  Storing a whole element is atomic by itself. */
+  bitmap_set_multiple (b, start, (idx + 1) * ELEM_BITS - start, value);
+  for (idx++; idx < last_idx; idx++)
+    b->bits[idx] = value ? (elem_type) -1 : 0;
+  bitmap_set_multiple (b, last_idx * ELEM_BITS,
+                       last - last_idx * ELEM_BITS + 1, value);
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -233,16 +316,27 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t idx, last_idx, last, value_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
+  if (cnt == 0)
+    return 0;
+
+  last = start + cnt - 1;
+  last_idx = elem_idx (last);
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  for (idx = elem_idx (start); idx <= last_idx; idx++)
+    {
+      elem_type e = match (b->bits[idx], value);
+      if (idx == elem_idx (start))
+        e &= (elem_type) -1 << (start % ELEM_BITS);
+      if (idx == last_idx)
+        e &= range_mask (0, last);
+      value_cnt += popcount (e);
+    }
   return value_cnt;
 }
 
@@ -251,16 +345,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return cnt > 0 && find_next (b, start, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -289,6 +378,34 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B that are all set to VALUE and lie
+   entirely at or after START and before END.
+   If there is no such group, returns BITMAP_ERROR.
+
+   Rather than checking every candidate position, alternately
+   skips to the next bit set to VALUE and then to the end of the
+   run of such bits, so that each element is looked at about
+   once. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end,
+            size_t cnt, bool value) 
+{
+  while (start < end && end - start >= cnt) 
+    {
+      size_t run_start = find_next (b, start, value);
+      size_t run_end;
+
+      if (run_start >= end || end - run_start < cnt)
+        break;
+      run_end = find_next (b, run_start, !value);
+      if (run_end - run_start >= cnt)
+        return run_start;
+      start = run_end;
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -299,15 +416,9 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+  return scan_range (b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -326,6 +437,52 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
   return idx;
 }
 
+/* Finds the first group of CNT consecutive bits in B that are
+   all set to VALUE, searching from *CURSOR to the end of B and
+   then wrapping around to the beginning, and returns the index
+   of the first bit in the group.  On success, advances *CURSOR
+   past the group, so that the next search resumes where this one
+   left off ("next fit").
+   If there is no such group, returns BITMAP_ERROR.
+   If CNT is zero, returns *CURSOR. */
+size_t
+bitmap_scan_next (const struct bitmap *b, size_t *cursor, size_t cnt,
+                  bool value) 
+{
+  size_t start, idx;
+
+  ASSERT (b != NULL);
+  ASSERT (cursor != NULL);
+
+  start = *cursor <= b->bit_cnt ? *cursor : 0;
+  if (cnt == 0)
+    return start;
+
+  idx = scan_range (b, start, b->bit_cnt, cnt, value);
+  if (idx == BITMAP_ERROR && start > 0)
+    {
+      /* Wrap around, to groups that start before START, which
+         may extend up to CNT - 1 bits past it. */
+      size_t end = start + cnt - 1 < b->bit_cnt ? start + cnt - 1 : b->bit_cnt;
+      idx = scan_range (b, 0, end, cnt, value);
+    }
+  if (idx != BITMAP_ERROR)
+    *cursor = idx + cnt;
+  return idx;
+}
+
+/* Like bitmap_scan_next(), but also flips the group of bits
+   found to !VALUE. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t *cursor, size_t cnt,
+                           bool value)
+{
+  size_t idx = bitmap_scan_next (b, cursor, cnt, value);
+  if (idx != BITMAP_ERROR) 
+    bitmap_set_multiple (b, idx, cnt, !value);
+  return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -9,6 +9,11 @@
 #include "../debug.h"
 #include "threads/malloc.h"
 
+/* Element per bucket ratios. */
+#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
+#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
+#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
+
 #define list_elem_to_hash_elem(LIST_ELEM)                       \
         list_entry(LIST_ELEM, struct hash_elem, list_elem)
 
@@ -18,6 +23,9 @@ static struct hash_elem *find_elem (struct hash *, struct list *,
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static bool start_resize (struct hash *, size_t new_bucket_cnt);
+static void migrate (struct hash *, size_t bucket_cnt);
+static void finish_resize (struct hash *);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -31,6 +39,11 @@ hash_init (struct hash *h,
   h->hash = hash;
   h->less = less;
   h->aux = aux;
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
+  h->min_bucket_cnt = 4;
+  h->resize_cnt = 0;
 
   if (h->buckets != NULL) 
     {
@@ -55,6 +68,7 @@ hash_clear (struct hash *h, hash_action_func *destructor)
 {
   size_t i;
 
+  finish_resize (h);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -88,9 +102,35 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
 {
   if (destructor != NULL)
     hash_clear (h, destructor);
+  free (h->old_buckets);
   free (h->buckets);
 }
 
+/* Makes hash table H big enough to hold ELEM_CNT elements
+   without growing, and keeps it from shrinking below that size,
+   so that a table whose eventual size is known can be sized once
+   up front.  Returns true if successful, false if memory could
+   not be allocated. */
+bool
+hash_reserve (struct hash *h, size_t elem_cnt) 
+{
+  size_t bucket_cnt = 4;
+
+  while (bucket_cnt < elem_cnt / BEST_ELEMS_PER_BUCKET)
+    bucket_cnt *= 2;
+
+  finish_resize (h);
+  if (bucket_cnt > h->bucket_cnt)
+    {
+      if (!start_resize (h, bucket_cnt))
+        return false;
+      finish_resize (h);
+    }
+  if (bucket_cnt > h->min_bucket_cnt)
+    h->min_bucket_cnt = bucket_cnt;
+  return true;
+}
+
 /* Inserts NEW into hash table H and returns a null pointer, if
    no equal element is already in the table.
    If an equal element is already in the table, returns it
@@ -166,6 +206,7 @@ hash_apply (struct hash *h, hash_action_func *action)
   
   ASSERT (action != NULL);
 
+  finish_resize (h);
   for (i = 0; i < h->bucket_cnt; i++) 
     {
       struct list *bucket = &h->buckets[i];
@@ -202,6 +243,7 @@ hash_first (struct hash_iterator *i, struct hash *h)
   ASSERT (i != NULL);
   ASSERT (h != NULL);
 
+  finish_resize (h);
   i->hash = h;
   i->bucket = i->hash->buckets;
   i->elem = list_elem_to_hash_elem (list_head (i->bucket));
@@ -257,6 +299,44 @@ hash_empty (struct hash *h)
   return h->elem_cnt == 0;
 }
 
+/* Adds the lengths of the CNT chains in BUCKETS to ST, skipping
+   new buckets of H that are not initialized yet and counting
+   them as empty. */
+static void
+add_chain_stats (struct hash *h, struct hash_stats *st,
+                 struct list *buckets, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++) 
+    {
+      bool ready = (buckets != h->buckets || h->old_buckets == NULL
+                    || (i & (h->old_bucket_cnt - 1)) < h->migrate_idx);
+      size_t len = ready ? list_size (&buckets[i]) : 0;
+      st->chain_hist[len < HASH_CHAIN_HIST ? len : HASH_CHAIN_HIST - 1]++;
+      if (len > st->max_chain)
+        st->max_chain = len;
+    }
+}
+
+/* Stores statistics about hash table H in *ST.  Takes time
+   proportional to the size of H. */
+void
+hash_get_stats (struct hash *h, struct hash_stats *st) 
+{
+  size_t i;
+
+  st->elem_cnt = h->elem_cnt;
+  st->bucket_cnt = h->bucket_cnt + h->old_bucket_cnt;
+  st->resize_cnt = h->resize_cnt;
+  st->max_chain = 0;
+  for (i = 0; i < HASH_CHAIN_HIST; i++)
+    st->chain_hist[i] = 0;
+  add_chain_stats (h, st, h->buckets, h->bucket_cnt);
+  if (h->old_buckets != NULL)
+    add_chain_stats (h, st, h->old_buckets, h->old_bucket_cnt);
+}
+
 /* Fowler-Noll-Vo hash constants, for 32-bit word sizes. */
 #define FNV_32_PRIME 16777619u
 #define FNV_32_BASIS 2166136261u
@@ -301,12 +381,21 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in.  While H is being
+   resized, that is its old bucket, unless that bucket has
+   already been emptied into the new array. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL)
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -339,77 +428,142 @@ is_power_of_2 (size_t x)
   return x != 0 && turn_off_least_1bit (x) == 0;
 }
 
-/* Element per bucket ratios. */
-#define MIN_ELEMS_PER_BUCKET  1 /* Elems/bucket < 1: reduce # of buckets. */
-#define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
-#define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
-
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
-   condition, but that'll just make hash accesses less efficient;
-   we can still continue. */
+/* Number of old buckets to empty on each insertion or deletion
+   while resizing.  Growing at MAX_ELEMS_PER_BUCKET to
+   BEST_ELEMS_PER_BUCKET leaves room for the table to double in
+   size before it needs to grow again, so any step of at least 1
+   finishes each resize before the next one is due. */
+#define MIGRATE_STEP 4
+
+/* Moves hash table H along toward the ideal number of buckets.
+   If H is being resized, empties a few more of its old buckets.
+   Otherwise, if H has too many or too few elements per bucket,
+   starts resizing it.  This function can fail because of an
+   out-of-memory condition, but that'll just make hash accesses
+   less efficient; we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
-  size_t i;
+  size_t new_bucket_cnt;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
-
-  /* Calculate the number of buckets to use now.
-     We want one bucket for about every BEST_ELEMS_PER_BUCKET.
-     We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
-  new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
-  if (new_bucket_cnt < 4)
-    new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
-
-  /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
-    return;
-
-  /* Allocate new buckets and initialize them as empty. */
+  if (h->old_buckets == NULL)
+    {
+      if (h->elem_cnt > h->bucket_cnt * MAX_ELEMS_PER_BUCKET
+          || (h->elem_cnt < h->bucket_cnt * MIN_ELEMS_PER_BUCKET
+              && h->bucket_cnt > h->min_bucket_cnt))
+        {
+          /* Calculate the number of buckets to use now.
+             We want one bucket for about every
+             BEST_ELEMS_PER_BUCKET.  We must have at least
+             min_bucket_cnt buckets, and the number of buckets
+             must be a power of 2. */
+          new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
+          if (new_bucket_cnt < h->min_bucket_cnt)
+            new_bucket_cnt = h->min_bucket_cnt;
+          while (!is_power_of_2 (new_bucket_cnt))
+            new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+
+          if (new_bucket_cnt == h->bucket_cnt
+              || !start_resize (h, new_bucket_cnt))
+            return;
+        }
+      else
+        return;
+    }
+
+  migrate (h, MIGRATE_STEP);
+}
+
+/* Starts resizing hash table H to NEW_BUCKET_CNT buckets, which
+   must be a power of 2, by installing a new bucket array and
+   making the current one the old array.  H must not already be
+   resizing.  Returns true if successful, false if memory could
+   not be allocated.
+
+   The new buckets are not initialized here, which would take
+   time proportional to their number.  Instead, migrate()
+   initializes the new buckets that old bucket I's elements hash
+   to, namely I, I + old_bucket_cnt, I + 2 * old_bucket_cnt, and
+   so on, just before it empties old bucket I.  find_bucket()
+   only returns a new bucket after that. */
+static bool
+start_resize (struct hash *h, size_t new_bucket_cnt) 
+{
+  struct list *new_buckets;
+
+  ASSERT (h->old_buckets == NULL);
+  ASSERT (is_power_of_2 (new_bucket_cnt));
+
+  /* Allocate new buckets. */
   new_buckets = malloc (sizeof *new_buckets * new_bucket_cnt);
   if (new_buckets == NULL) 
     {
       /* Allocation failed.  This means that use of the hash table will
          be less efficient.  However, it is still usable, so
          there's no reason for it to be an error. */
-      return;
+      return false;
     }
-  for (i = 0; i < new_bucket_cnt; i++) 
-    list_init (&new_buckets[i]);
 
   /* Install new bucket info. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->migrate_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
+  h->resize_cnt++;
+  return true;
+}
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
-    {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
+/* Moves the elements of up to BUCKET_CNT more old buckets in
+   hash table H into the new buckets, and finishes the resize if
+   no old buckets remain. */
+static void
+migrate (struct hash *h, size_t bucket_cnt) 
+{
+  ASSERT (h->old_buckets != NULL);
 
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
+  for (; bucket_cnt > 0 && h->migrate_idx < h->old_bucket_cnt; bucket_cnt--)
+    {
+      struct list *old_bucket = &h->old_buckets[h->migrate_idx];
+      size_t i;
+
+      /* Initialize the new buckets for OLD_BUCKET's elements.
+         When shrinking, there is one for the first
+         new_bucket_cnt old buckets, and the later ones share
+         them. */
+      for (i = h->migrate_idx; i < h->bucket_cnt; i += h->old_bucket_cnt)
+        list_init (&h->buckets[i]);
+
+      /* Once migrate_idx is past OLD_BUCKET, find_bucket()
+         returns the new bucket for each of its elements. */
+      h->migrate_idx++;
+      while (!list_empty (old_bucket)) 
         {
+          struct list_elem *elem = list_pop_front (old_bucket);
           struct list *new_bucket
             = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
           list_push_front (new_bucket, elem);
         }
     }
 
-  free (old_buckets);
+  if (h->migrate_idx >= h->old_bucket_cnt)
+    {
+      free (h->old_buckets);
+      h->old_buckets = NULL;
+      h->old_bucket_cnt = 0;
+      h->migrate_idx = 0;
+    }
+}
+
+/* Finishes any resize of hash table H in progress, so that all
+   of its elements are in `buckets'. */
+static void
+finish_resize (struct hash *h) 
+{
+  if (h->old_buckets != NULL)
+    migrate (h, h->old_bucket_cnt);
 }
 
 /* Inserts E into BUCKET (in hash table H). */
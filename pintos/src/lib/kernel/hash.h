@@ -18,7 +18,14 @@
    conversion from a struct hash_elem back to a structure object
    that contains it.  This is the same technique used in the
    linked list implementation.  Refer to lib/kernel/list.h for a
-   detailed explanation. */
+   detailed explanation.
+
+   The table grows and shrinks to keep the number of elements
+   per bucket in a fixed range.  Rather than moving every element
+   to a new bucket array at once, which would make a single
+   insertion or deletion take time proportional to the size of
+   the table, it keeps the old array around and moves a few of
+   its buckets to the new one on each insertion or deletion. */
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -64,6 +71,27 @@ struct hash
     hash_hash_func *hash;       /* Hash function. */
     hash_less_func *less;       /* Comparison function. */
     void *aux;                  /* Auxiliary data for `hash' and `less'. */
+
+    /* While resizing, the buckets being emptied into `buckets'.
+       Old buckets before `migrate_idx' are already empty. */
+    struct list *old_buckets;   /* Old bucket array, or null. */
+    size_t old_bucket_cnt;      /* Number of old buckets. */
+    size_t migrate_idx;         /* Next old bucket to empty. */
+
+    size_t min_bucket_cnt;      /* Never shrink below; see hash_reserve(). */
+    size_t resize_cnt;          /* Number of resizes started. */
+  };
+
+/* Hash table statistics, from hash_get_stats(). */
+#define HASH_CHAIN_HIST 8
+struct hash_stats
+  {
+    size_t elem_cnt;            /* Number of elements. */
+    size_t bucket_cnt;          /* Number of buckets, old and new. */
+    size_t resize_cnt;          /* Number of resizes started. */
+    size_t max_chain;           /* Most elements in one bucket. */
+    size_t chain_hist[HASH_CHAIN_HIST]; /* Buckets by number of elements,
+                                           the last counting all larger. */
   };
 
 /* A hash table iterator. */
@@ -78,6 +106,7 @@ struct hash_iterator
 bool hash_init (struct hash *, hash_hash_func *, hash_less_func *, void *aux);
 void hash_clear (struct hash *, hash_action_func *);
 void hash_destroy (struct hash *, hash_action_func *);
+bool hash_reserve (struct hash *, size_t elem_cnt);
 
 /* Search, insertion, deletion. */
 struct hash_elem *hash_insert (struct hash *, struct hash_elem *);
@@ -94,6 +123,7 @@ struct hash_elem *hash_cur (struct hash_iterator *);
 /* Information. */
 size_t hash_size (struct hash *);
 bool hash_empty (struct hash *);
+void hash_get_stats (struct hash *, struct hash_stats *);
 
 /* Sample hash functions. */
 unsigned hash_bytes (const void *, size_t);
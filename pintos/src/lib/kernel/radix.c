@@ -0,0 +1,362 @@
+#include "radix.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Radix tree.
+
+   A tree of height H has H levels of nodes.  The root looks up
+   bits 6*(H-1) and up of an index, and each level below it the
+   next 6 bits, so that the slots of the bottom level hold the
+   items themselves.  A tree of height 6 can hold any 32-bit
+   index.
+
+   A node holds nothing but its slots, 256 bytes in all, which
+   matches one of malloc()'s block sizes exactly.  Its number of
+   used slots is not stored: it is only needed when deleting,
+   and then it is cheaper to check the slots than to keep a
+   count up to date on every insertion. */
+
+/* Slots per node. */
+#define RADIX_SLOTS (1u << RADIX_BITS)
+#define RADIX_MASK (RADIX_SLOTS - 1)
+
+/* Greatest possible height. */
+#define RADIX_MAX_HEIGHT ((32 + RADIX_BITS - 1) / RADIX_BITS)
+
+/* Interior or bottom-level node. */
+struct radix_node
+  {
+    void *slots[RADIX_SLOTS];   /* Child nodes, or items at the bottom. */
+  };
+
+static struct radix_node *new_node (struct radix_tree *);
+static void free_node (struct radix_tree *, struct radix_node *);
+static bool node_empty (const struct radix_node *);
+static void *next_item (const struct radix_node *, int shift,
+                        uint32_t base, uint32_t start, uint32_t *index);
+static void prune (struct radix_tree *, uint32_t index);
+static void destroy_node (struct radix_node *, int shift, uint32_t base,
+                          radix_action_func *, void *aux);
+
+/* Returns true if a tree of height HEIGHT can hold INDEX. */
+static inline bool
+fits (int height, uint32_t index) 
+{
+  return height * RADIX_BITS >= 32 || index >> (height * RADIX_BITS) == 0;
+}
+
+/* Returns the slot of node N, at a level that looks up the bits
+   of INDEX starting at bit SHIFT, that INDEX belongs in. */
+static inline void **
+slot_of (const struct radix_node *n, int shift, uint32_t index) 
+{
+  return (void **) &n->slots[(index >> shift) & RADIX_MASK];
+}
+
+/* Initializes TREE as an empty radix tree. */
+void
+radix_init (struct radix_tree *tree) 
+{
+  ASSERT (tree != NULL);
+
+  tree->root = NULL;
+  tree->height = 0;
+  tree->entry_cnt = 0;
+  tree->node_cnt = 0;
+}
+
+/* Frees all of TREE's nodes.  If ACTION is non-null, then it is
+   called for each entry in TREE, in order of increasing index,
+   given auxiliary data AUX, before the nodes are freed.  TREE
+   is left empty and may be reused. */
+void
+radix_destroy (struct radix_tree *tree, radix_action_func *action,
+               void *aux) 
+{
+  if (tree->root != NULL)
+    destroy_node (tree->root, (tree->height - 1) * RADIX_BITS, 0,
+                  action, aux);
+  radix_init (tree);
+}
+
+/* Stores ITEM, which must be non-null, at INDEX in TREE.
+   Returns true if successful, false if INDEX was already in use
+   or memory could not be allocated. */
+bool
+radix_insert (struct radix_tree *tree, uint32_t index, void *item) 
+{
+  struct radix_node *n;
+  void **slot;
+  int shift;
+
+  ASSERT (item != NULL);
+
+  /* Make the tree tall enough for INDEX.  An empty tree just
+     takes the needed height; otherwise the old root becomes
+     slot 0 of a new root, since all its indexes are smaller than
+     those of any other slot. */
+  if (tree->root == NULL)
+    for (tree->height = 1; !fits (tree->height, index); tree->height++)
+      continue;
+  else
+    while (!fits (tree->height, index))
+      {
+        n = new_node (tree);
+        if (n == NULL)
+          {
+            prune (tree, index);
+            return false;
+          }
+        n->slots[0] = tree->root;
+        tree->root = n;
+        tree->height++;
+      }
+
+  /* Walk down, adding missing nodes. */
+  slot = (void **) &tree->root;
+  for (shift = (tree->height - 1) * RADIX_BITS; shift >= 0;
+       shift -= RADIX_BITS)
+    {
+      if (*slot == NULL)
+        {
+          *slot = new_node (tree);
+          if (*slot == NULL)
+            {
+              prune (tree, index);
+              return false;
+            }
+        }
+      slot = slot_of (*slot, shift, index);
+    }
+
+  if (*slot != NULL)
+    return false;
+  *slot = item;
+  tree->entry_cnt++;
+  return true;
+}
+
+/* Returns the item stored at INDEX in TREE, or a null pointer if
+   there is none. */
+void *
+radix_lookup (const struct radix_tree *tree, uint32_t index) 
+{
+  const struct radix_node *n = tree->root;
+  int shift;
+
+  if (n == NULL || !fits (tree->height, index))
+    return NULL;
+  for (shift = (tree->height - 1) * RADIX_BITS; shift > 0;
+       shift -= RADIX_BITS)
+    {
+      n = *slot_of (n, shift, index);
+      if (n == NULL)
+        return NULL;
+    }
+  return *slot_of (n, 0, index);
+}
+
+/* Finds the entry in TREE with the smallest index that is at
+   least *INDEX.  If there is one, stores its index in *INDEX and
+   returns its item; otherwise, returns a null pointer.  To visit
+   every entry in order:
+
+      uint32_t idx;
+      void *item;
+
+      for (idx = 0; (item = radix_lookup_next (&tree, &idx)) != NULL;
+           idx++)
+        {
+          ...do something with item...
+          if (idx == UINT32_MAX)
+            break;
+        }
+*/
+void *
+radix_lookup_next (const struct radix_tree *tree, uint32_t *index) 
+{
+  if (tree->root == NULL || !fits (tree->height, *index))
+    return NULL;
+  return next_item (tree->root, (tree->height - 1) * RADIX_BITS, 0,
+                    *index, index);
+}
+
+/* Removes the entry at INDEX from TREE and returns its item, or
+   returns a null pointer if there was none. */
+void *
+radix_delete (struct radix_tree *tree, uint32_t index) 
+{
+  const struct radix_node *n = tree->root;
+  void **slot;
+  void *item;
+  int shift;
+
+  if (n == NULL || !fits (tree->height, index))
+    return NULL;
+  for (shift = (tree->height - 1) * RADIX_BITS; ; shift -= RADIX_BITS)
+    {
+      slot = slot_of (n, shift, index);
+      if (shift == 0 || *slot == NULL)
+        break;
+      n = *slot;
+    }
+  item = *slot;
+  if (item != NULL)
+    {
+      *slot = NULL;
+      tree->entry_cnt--;
+      prune (tree, index);
+    }
+  return item;
+}
+
+/* Returns the number of entries in TREE. */
+size_t
+radix_size (const struct radix_tree *tree) 
+{
+  return tree->entry_cnt;
+}
+
+/* Returns true if TREE has no entries, false otherwise. */
+bool
+radix_empty (const struct radix_tree *tree) 
+{
+  return tree->entry_cnt == 0;
+}
+
+/* Returns the number of nodes allocated for TREE. */
+size_t
+radix_node_cnt (const struct radix_tree *tree) 
+{
+  return tree->node_cnt;
+}
+
+/* Allocates and returns a node with all slots empty, or returns
+   a null pointer if memory is not available. */
+static struct radix_node *
+new_node (struct radix_tree *tree) 
+{
+  struct radix_node *n = calloc (1, sizeof *n);
+
+  if (n != NULL)
+    tree->node_cnt++;
+  return n;
+}
+
+/* Frees node N of TREE. */
+static void
+free_node (struct radix_tree *tree, struct radix_node *n) 
+{
+  free (n);
+  tree->node_cnt--;
+}
+
+/* Returns true if no slot of node N is in use. */
+static bool
+node_empty (const struct radix_node *n) 
+{
+  size_t i;
+
+  for (i = 0; i < RADIX_SLOTS; i++)
+    if (n->slots[i] != NULL)
+      return false;
+  return true;
+}
+
+/* Frees the nodes on the path to INDEX in TREE that have no
+   slots in use, from the bottom up, then lowers the tree while
+   its root uses only slot 0, whose child can take its place. */
+static void
+prune (struct radix_tree *tree, uint32_t index) 
+{
+  struct radix_node *path[RADIX_MAX_HEIGHT];
+  void **parent_slot[RADIX_MAX_HEIGHT];
+  void **slot = (void **) &tree->root;
+  int level, shift;
+
+  for (level = 0, shift = (tree->height - 1) * RADIX_BITS;
+       shift >= 0 && *slot != NULL; level++, shift -= RADIX_BITS)
+    {
+      path[level] = *slot;
+      parent_slot[level] = slot;
+      slot = slot_of (*slot, shift, index);
+    }
+  while (level-- > 0 && node_empty (path[level]))
+    {
+      free_node (tree, path[level]);
+      *parent_slot[level] = NULL;
+    }
+
+  if (tree->root == NULL)
+    {
+      tree->height = 0;
+      return;
+    }
+  while (tree->height > 1)
+    {
+      struct radix_node *root = tree->root;
+      size_t i;
+
+      for (i = 1; i < RADIX_SLOTS; i++)
+        if (root->slots[i] != NULL)
+          return;
+      tree->root = root->slots[0];
+      tree->height--;
+      free_node (tree, root);
+    }
+}
+
+/* Finds the first item at or after index START below node N,
+   whose first slot holds index BASE and which looks up the bits
+   of an index starting at bit SHIFT.  START must be within N's
+   range.  If found, stores its index in *INDEX and returns the
+   item; otherwise, returns a null pointer. */
+static void *
+next_item (const struct radix_node *n, int shift, uint32_t base,
+           uint32_t start, uint32_t *index) 
+{
+  size_t i;
+
+  for (i = (start >> shift) & RADIX_MASK; i < RADIX_SLOTS; i++)
+    {
+      void *slot = n->slots[i];
+      uint32_t slot_base;
+
+      if (slot == NULL)
+        continue;
+      slot_base = base + ((uint32_t) i << shift);
+      if (shift == 0)
+        {
+          *index = slot_base;
+          return slot;
+        }
+      slot = next_item (slot, shift - RADIX_BITS, slot_base,
+                        start > slot_base ? start : slot_base, index);
+      if (slot != NULL)
+        return slot;
+    }
+  return NULL;
+}
+
+/* Calls ACTION, if non-null, for each item below node N, in
+   order, then frees N and the nodes below it.  N's first slot
+   holds index BASE and it looks up the bits of an index starting
+   at bit SHIFT. */
+static void
+destroy_node (struct radix_node *n, int shift, uint32_t base,
+              radix_action_func *action, void *aux) 
+{
+  size_t i;
+
+  for (i = 0; i < RADIX_SLOTS; i++)
+    if (n->slots[i] != NULL)
+      {
+        uint32_t slot_base = base + ((uint32_t) i << shift);
+        if (shift > 0)
+          destroy_node (n->slots[i], shift - RADIX_BITS, slot_base,
+                        action, aux);
+        else if (action != NULL)
+          action (slot_base, n->slots[i], aux);
+      }
+  free (n);
+}
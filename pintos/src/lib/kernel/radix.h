@@ -0,0 +1,53 @@
+#ifndef __LIB_KERNEL_RADIX_H
+#define __LIB_KERNEL_RADIX_H
+
+/* Radix tree.
+
+   A radix tree maps 32-bit indexes, such as the page numbers
+   within a file, to non-null pointers.  Each level of the tree
+   looks up RADIX_BITS bits of the index, so a lookup takes at
+   most 6 steps and never compares keys.  The tree is only as
+   tall as its largest index requires, and interior nodes exist
+   only where there are entries below them, so a sparse set of
+   small indexes, as in a page cache, takes little memory.
+
+   Unlike the list, hash table, and red-black tree, the radix
+   tree does not use embedded elements: it stores the caller's
+   pointers in its own nodes, which it allocates with malloc().
+   An insertion can therefore fail for lack of memory. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of index bits looked up at each level. */
+#define RADIX_BITS 6
+
+/* Performs some operation on ITEM, stored at INDEX, given
+   auxiliary data AUX. */
+typedef void radix_action_func (uint32_t index, void *item, void *aux);
+
+/* Radix tree. */
+struct radix_tree
+  {
+    struct radix_node *root;    /* Root node, or NULL if empty. */
+    int height;                 /* Levels of nodes, 0 if empty. */
+    size_t entry_cnt;           /* Number of entries. */
+    size_t node_cnt;            /* Number of nodes. */
+  };
+
+void radix_init (struct radix_tree *);
+void radix_destroy (struct radix_tree *, radix_action_func *, void *aux);
+
+/* Insertion, lookup, deletion. */
+bool radix_insert (struct radix_tree *, uint32_t index, void *item);
+void *radix_lookup (const struct radix_tree *, uint32_t index);
+void *radix_lookup_next (const struct radix_tree *, uint32_t *index);
+void *radix_delete (struct radix_tree *, uint32_t index);
+
+/* Information. */
+size_t radix_size (const struct radix_tree *);
+bool radix_empty (const struct radix_tree *);
+size_t radix_node_cnt (const struct radix_tree *);
+
+#endif /* lib/kernel/radix.h */
@@ -0,0 +1,446 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree.
+
+   Every node is red or black, the root is black, a red node has
+   no red children, and every path from a node down to a missing
+   child passes through the same number of black nodes.  Together
+   these keep the longest path from the root at most twice the
+   shortest, so the height is O(lg n).
+
+   Missing children are represented by null pointers, which count
+   as black.  The algorithms are those of [CLRS] chapter 13,
+   adapted to do without a sentinel node. */
+
+static void replace_child (struct rb_tree *, struct rb_node *parent,
+                           struct rb_node *old, struct rb_node *new);
+static void rotate_left (struct rb_tree *, struct rb_node *);
+static void rotate_right (struct rb_tree *, struct rb_node *);
+static void insert_fixup (struct rb_tree *, struct rb_node *);
+static void remove_fixup (struct rb_tree *, struct rb_node *,
+                          struct rb_node *parent);
+
+/* Returns true if node N is red.  Null children are black. */
+static inline bool
+is_red (const struct rb_node *n)
+{
+  return n != NULL && n->red;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, given
+   auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux)
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->min = NULL;
+  tree->node_cnt = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts node N into TREE.  N is placed after every node that
+   compares equal to it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_node *n)
+{
+  struct rb_node *parent = NULL;
+  struct rb_node **link = &tree->root;
+  bool leftmost = true;
+
+  ASSERT (n != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (tree->less (n, parent, tree->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  n->parent = parent;
+  n->left = n->right = NULL;
+  n->red = true;
+  *link = n;
+  if (leftmost)
+    tree->min = n;
+  tree->node_cnt++;
+
+  insert_fixup (tree, n);
+}
+
+/* Removes node N from TREE.  N must be in TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_node *n)
+{
+  struct rb_node *child, *parent;
+  bool red;
+
+  ASSERT (n != NULL);
+  ASSERT (tree->node_cnt > 0);
+
+  if (tree->min == n)
+    tree->min = rb_next (n);
+
+  if (n->left == NULL || n->right == NULL)
+    {
+      /* N has at most one child, which takes its place. */
+      child = n->left != NULL ? n->left : n->right;
+      parent = n->parent;
+      red = n->red;
+      if (child != NULL)
+        child->parent = parent;
+      replace_child (tree, parent, n, child);
+    }
+  else
+    {
+      /* N's successor S, which has no left child, takes N's
+         place and color; S's right child takes S's place. */
+      struct rb_node *s = n->right;
+      while (s->left != NULL)
+        s = s->left;
+
+      child = s->right;
+      red = s->red;
+      if (s->parent == n)
+        parent = s;
+      else
+        {
+          parent = s->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          s->right = n->right;
+          s->right->parent = s;
+        }
+      s->left = n->left;
+      s->left->parent = s;
+      s->parent = n->parent;
+      s->red = n->red;
+      replace_child (tree, n->parent, n, s);
+    }
+  tree->node_cnt--;
+
+  /* Removing a black node shortens the paths through CHILD. */
+  if (!red)
+    remove_fixup (tree, child, parent);
+}
+
+/* Removes and returns the minimum node in TREE, or returns a
+   null pointer if TREE is empty. */
+struct rb_node *
+rb_pop_min (struct rb_tree *tree)
+{
+  struct rb_node *n = tree->min;
+
+  if (n != NULL)
+    rb_remove (tree, n);
+  return n;
+}
+
+/* Returns the first node in TREE that compares equal to KEY, or
+   a null pointer if there is none. */
+struct rb_node *
+rb_find (struct rb_tree *tree, const struct rb_node *key)
+{
+  struct rb_node *n = rb_lower_bound (tree, key);
+
+  if (n != NULL && !tree->less (key, n, tree->aux))
+    return n;
+  return NULL;
+}
+
+/* Returns the first node in TREE that is not less than KEY, or a
+   null pointer if every node is less than KEY. */
+struct rb_node *
+rb_lower_bound (struct rb_tree *tree, const struct rb_node *key)
+{
+  struct rb_node *n = tree->root;
+  struct rb_node *result = NULL;
+
+  while (n != NULL)
+    if (tree->less (n, key, tree->aux))
+      n = n->right;
+    else
+      {
+        result = n;
+        n = n->left;
+      }
+  return result;
+}
+
+/* Returns the first node in TREE that is greater than KEY, or a
+   null pointer if no node is greater than KEY.  The last node
+   not greater than KEY, as needed to find the range that
+   contains an address, is the rb_prev() of the result, or
+   rb_max() if the result is null. */
+struct rb_node *
+rb_upper_bound (struct rb_tree *tree, const struct rb_node *key)
+{
+  struct rb_node *n = tree->root;
+  struct rb_node *result = NULL;
+
+  while (n != NULL)
+    if (tree->less (key, n, tree->aux))
+      {
+        result = n;
+        n = n->left;
+      }
+    else
+      n = n->right;
+  return result;
+}
+
+/* Returns the minimum node in TREE, or a null pointer if TREE is
+   empty.  Takes constant time. */
+struct rb_node *
+rb_min (const struct rb_tree *tree)
+{
+  return tree->min;
+}
+
+/* Returns the maximum node in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_node *
+rb_max (const struct rb_tree *tree)
+{
+  struct rb_node *n = tree->root;
+
+  if (n != NULL)
+    while (n->right != NULL)
+      n = n->right;
+  return n;
+}
+
+/* Returns the node that follows N in its tree, or a null pointer
+   if N is the maximum. */
+struct rb_node *
+rb_next (const struct rb_node *n)
+{
+  if (n->right != NULL)
+    {
+      n = n->right;
+      while (n->left != NULL)
+        n = n->left;
+      return (struct rb_node *) n;
+    }
+  while (n->parent != NULL && n == n->parent->right)
+    n = n->parent;
+  return n->parent;
+}
+
+/* Returns the node that precedes N in its tree, or a null
+   pointer if N is the minimum. */
+struct rb_node *
+rb_prev (const struct rb_node *n)
+{
+  if (n->left != NULL)
+    {
+      n = n->left;
+      while (n->right != NULL)
+        n = n->right;
+      return (struct rb_node *) n;
+    }
+  while (n->parent != NULL && n == n->parent->left)
+    n = n->parent;
+  return n->parent;
+}
+
+/* Returns the number of nodes in TREE. */
+size_t
+rb_size (const struct rb_tree *tree)
+{
+  return tree->node_cnt;
+}
+
+/* Returns true if TREE contains no nodes, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree)
+{
+  return tree->root == NULL;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as the
+   root of TREE if PARENT is null. */
+static void
+replace_child (struct rb_tree *tree, struct rb_node *parent,
+               struct rb_node *old, struct rb_node *new)
+{
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its parent. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_node *x)
+{
+  struct rb_node *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child (tree, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its parent. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_node *x)
+{
+  struct rb_node *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child (tree, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Restores the red-black properties after inserting red node N,
+   which may now have a red parent. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_node *n)
+{
+  struct rb_node *p;
+
+  while (is_red (p = n->parent))
+    {
+      /* P is red, so it is not the root and G exists. */
+      struct rb_node *g = p->parent;
+
+      if (p == g->left)
+        {
+          struct rb_node *u = g->right;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              n = g;
+              continue;
+            }
+          if (n == p->right)
+            {
+              rotate_left (tree, p);
+              n = p;
+              p = n->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_right (tree, g);
+        }
+      else
+        {
+          struct rb_node *u = g->left;
+          if (is_red (u))
+            {
+              p->red = u->red = false;
+              g->red = true;
+              n = g;
+              continue;
+            }
+          if (n == p->left)
+            {
+              rotate_right (tree, p);
+              n = p;
+              p = n->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_left (tree, g);
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above X, a possibly null child of PARENT, leaving
+   the paths through X one black node short. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_node *x,
+              struct rb_node *parent)
+{
+  while (x != tree->root && !is_red (x))
+    {
+      /* X's sibling W exists, because the paths through it have
+         at least one more black node than those through X. */
+      if (x == parent->left)
+        {
+          struct rb_node *w = parent->right;
+          if (w->red)
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+              continue;
+            }
+          if (!is_red (w->right))
+            {
+              w->left->red = false;
+              w->red = true;
+              rotate_right (tree, w);
+              w = parent->right;
+            }
+          w->red = parent->red;
+          parent->red = false;
+          w->right->red = false;
+          rotate_left (tree, parent);
+        }
+      else
+        {
+          struct rb_node *w = parent->left;
+          if (w->red)
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right))
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+              continue;
+            }
+          if (!is_red (w->left))
+            {
+              w->right->red = false;
+              w->red = true;
+              rotate_left (tree, w);
+              w = parent->left;
+            }
+          w->red = parent->red;
+          parent->red = false;
+          w->left->red = false;
+          rotate_right (tree, parent);
+        }
+      x = tree->root;
+    }
+  if (x != NULL)
+    x->red = false;
+}
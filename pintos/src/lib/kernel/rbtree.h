@@ -0,0 +1,83 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+
+   A red-black tree is a binary search tree that keeps itself
+   roughly balanced, so that insertion, deletion, and lookup all
+   take O(lg n) time in the worst case.  This implementation also
+   caches the tree's minimum element, so that rb_min() is O(1),
+   which makes the tree suitable as a priority queue.
+
+   Like the linked list and hash table implementations, the tree
+   does not use dynamic allocation.  Instead, each structure that
+   can potentially be in a tree must embed a struct rb_node
+   member, and the rb_entry macro converts from a struct rb_node
+   back to the structure that contains it.  Refer to
+   lib/kernel/list.h for a detailed explanation.
+
+   Elements that compare equal are kept in insertion order: a new
+   element is placed after every element equal to it.  Thus, a
+   tree used as a priority queue is FIFO among equal keys. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree node. */
+struct rb_node
+  {
+    struct rb_node *parent;     /* Parent, or NULL at the root. */
+    struct rb_node *left;       /* Left child, or NULL. */
+    struct rb_node *right;      /* Right child, or NULL. */
+    bool red;                   /* Red or black? */
+  };
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)                       \
+        ((STRUCT *) ((uint8_t *) (RB_NODE)                      \
+                     - offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two tree nodes A and B, given auxiliary
+   data AUX.  Returns true if A is less than B, or false if A is
+   greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+                           const struct rb_node *b,
+                           void *aux);
+
+/* Red-black tree. */
+struct rb_tree
+  {
+    struct rb_node *root;       /* Root node, or NULL if empty. */
+    struct rb_node *min;        /* Leftmost node, or NULL if empty. */
+    size_t node_cnt;            /* Number of nodes. */
+    rb_less_func *less;         /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+/* Insertion and removal. */
+void rb_insert (struct rb_tree *, struct rb_node *);
+void rb_remove (struct rb_tree *, struct rb_node *);
+struct rb_node *rb_pop_min (struct rb_tree *);
+
+/* Lookup. */
+struct rb_node *rb_find (struct rb_tree *, const struct rb_node *);
+struct rb_node *rb_lower_bound (struct rb_tree *, const struct rb_node *);
+struct rb_node *rb_upper_bound (struct rb_tree *, const struct rb_node *);
+
+/* Traversal. */
+struct rb_node *rb_min (const struct rb_tree *);
+struct rb_node *rb_max (const struct rb_tree *);
+struct rb_node *rb_next (const struct rb_node *);
+struct rb_node *rb_prev (const struct rb_node *);
+
+/* Information. */
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/* Scheduler statistics for one thread, kept while the kernel
+   runs with -schedstat.  Times are in TSC cycles.  Shared by the
+   kernel and user programs, which read their own statistics with
+   the schedstat system call. */
+struct schedstat
+  {
+    uint64_t run_cycles;        /* Time spent running. */
+    uint64_t ready_cycles;      /* Time spent ready to run. */
+    uint64_t max_ready_cycles;  /* Longest single wait to run. */
+    uint32_t dispatches;        /* Times switched to. */
+    uint32_t voluntary;         /* Switches away by blocking or yielding. */
+    uint32_t involuntary;       /* Switches away by preemption. */
+  };
+
+#endif /* lib/schedstat.h */
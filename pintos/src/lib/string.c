@@ -1,5 +1,81 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The memory block functions below move 32-bit words at a time
+   instead of single bytes.  x86 allows unaligned word accesses,
+   so only the destination is brought to a word boundary, one
+   byte at a time; the source may stay unaligned.  Blocks of at
+   least REP_THRESHOLD bytes use the `rep movsl' and `rep stosl'
+   string instructions, which cost a few dozen cycles to start
+   but then move data faster than a loop.  See [IA32-v2b] "MOVS"
+   and "STOS", and [IA32-v1] 7.3.9.3 "Fast-String Operation". */
+
+/* A word that may alias any other type, so that word accesses
+   to byte buffers are not subject to strict aliasing. */
+typedef uint32_t __attribute__ ((may_alias)) word_t;
+
+#define WORD_SIZE sizeof (word_t)
+#define REP_THRESHOLD 256
+
+/* Copies SIZE bytes from SRC to DST, front to back, and returns
+   DST + SIZE.  Safe for overlapping blocks if DST < SRC. */
+static inline unsigned char *
+copy_forward (unsigned char *dst, const unsigned char *src, size_t size) 
+{
+  /* Align the destination. */
+  while (size > 0 && (uintptr_t) dst % WORD_SIZE != 0)
+    {
+      *dst++ = *src++;
+      size--;
+    }
+
+  if (size >= REP_THRESHOLD)
+    {
+      size_t words = size / WORD_SIZE;
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words)
+                    : : "memory");
+      size %= WORD_SIZE;
+    }
+  else
+    for (; size >= WORD_SIZE; size -= WORD_SIZE)
+      {
+        *(word_t *) dst = *(const word_t *) src;
+        dst += WORD_SIZE;
+        src += WORD_SIZE;
+      }
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst;
+}
+
+/* Copies SIZE bytes from SRC to DST, back to front.  Safe for
+   overlapping blocks if DST > SRC. */
+static inline void
+copy_backward (unsigned char *dst, const unsigned char *src, size_t size) 
+{
+  dst += size;
+  src += size;
+
+  /* Align the destination's end. */
+  while (size > 0 && (uintptr_t) dst % WORD_SIZE != 0)
+    {
+      *--dst = *--src;
+      size--;
+    }
+
+  for (; size >= WORD_SIZE; size -= WORD_SIZE)
+    {
+      dst -= WORD_SIZE;
+      src -= WORD_SIZE;
+      *(word_t *) dst = *(const word_t *) src;
+    }
+
+  while (size-- > 0)
+    *--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,9 +88,7 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
-
+  copy_forward (dst, src, size);
   return dst_;
 }
 
@@ -29,20 +103,15 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
-    {
-      while (size-- > 0)
-        *dst++ = *src++;
-    }
-  else 
-    {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
-    }
+  /* Copying front to back is safe unless DST starts inside
+     SRC.  `rep movsl' also copies front to back, one word after
+     another, so it is safe here too. */
+  if (dst <= src || dst >= src + size)
+    copy_forward (dst, src, size);
+  else
+    copy_backward (dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +127,15 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip equal words, then find the differing byte. */
+  for (; size >= WORD_SIZE; size -= WORD_SIZE)
+    {
+      if (*(const word_t *) a != *(const word_t *) b)
+        break;
+      a += WORD_SIZE;
+      b += WORD_SIZE;
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -279,9 +357,33 @@ void *
 memset (void *dst_, int value, size_t size) 
 {
   unsigned char *dst = dst_;
+  word_t word = (unsigned char) value * 0x01010101u;
 
   ASSERT (dst != NULL || size == 0);
   
+  /* Align the destination. */
+  while (size > 0 && (uintptr_t) dst % WORD_SIZE != 0)
+    {
+      *dst++ = value;
+      size--;
+    }
+
+  if (size >= REP_THRESHOLD)
+    {
+      size_t words = size / WORD_SIZE;
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words)
+                    : "a" (word)
+                    : "memory");
+      size %= WORD_SIZE;
+    }
+  else
+    for (; size >= WORD_SIZE; size -= WORD_SIZE)
+      {
+        *(word_t *) dst = word;
+        dst += WORD_SIZE;
+      }
+
   while (size-- > 0)
     *dst++ = value;
 
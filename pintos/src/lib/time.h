@@ -0,0 +1,18 @@
+#ifndef __LIB_TIME_H
+#define __LIB_TIME_H
+
+#include <stdint.h>
+
+/* Clocks that can be read with the clock_gettime system call. */
+#define CLOCK_REALTIME 0        /* Wall-clock time since the epoch. */
+#define CLOCK_MONOTONIC 1       /* Time since boot, never set back. */
+
+/* A time, as seconds and nanoseconds.  Shared by the kernel and
+   user programs. */
+struct timespec
+  {
+    int64_t tv_sec;             /* Seconds. */
+    int32_t tv_nsec;            /* Nanoseconds, 0 to 999,999,999. */
+  };
+
+#endif /* lib/time.h */
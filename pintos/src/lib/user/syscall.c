@@ -182,3 +182,15 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+schedstat (struct schedstat *st) 
+{
+  return syscall1 (SYS_SCHEDSTAT, st);
+}
+
+bool
+clock_gettime (int clock, struct timespec *ts) 
+{
+  return syscall2 (SYS_CLOCK_GETTIME, clock, ts);
+}
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <schedstat.h>
+#include <time.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +47,8 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool schedstat (struct schedstat *);
+bool clock_gettime (int clock, struct timespec *);
+
 #endif /* lib/user/syscall.h */
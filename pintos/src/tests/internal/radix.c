@@ -0,0 +1,247 @@
+/* Test program and benchmark for lib/kernel/radix.c.
+
+   First inserts and deletes random indexes, some small and dense
+   as in a file's page cache and some spread over the whole
+   32-bit range, checking after each step that radix_lookup() and
+   radix_lookup_next() agree with a table of what should be
+   there, and that deleting everything frees every node.
+
+   Then compares the cycles per operation of a radix tree and a
+   hash table for inserting, looking up, and deleting the page
+   indexes of a file, both contiguous and scattered, and prints
+   the number of radix tree nodes used.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <radix.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "threads/tsc.h"
+
+/* Number of distinct indexes in the correctness test. */
+#define CHECK_SIZE 1024
+
+/* Largest number of pages to time. */
+#define MAX_SIZE 8192
+
+/* A cached page, as it might appear in a page cache. */
+struct page 
+  {
+    struct hash_elem hash_elem; /* Hash table element. */
+    uint32_t index;             /* Page index. */
+    bool present;               /* In the tree? */
+  };
+
+static struct page pages[MAX_SIZE];
+
+static void check (void);
+static void check_next (struct radix_tree *, uint32_t start);
+static void count_action (uint32_t index, void *item, void *aux);
+static void bench (const char *name, size_t size, uint32_t stride);
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+
+/* Tests and benchmarks the radix tree. */
+void
+test (void) 
+{
+  check ();
+
+  printf ("cycles per operation:\n");
+  printf ("%-10s %6s %-6s %8s %8s\n", "indexes", "size", "op",
+          "radix", "hash");
+  bench ("contiguous", 64, 1);
+  bench ("contiguous", MAX_SIZE, 1);
+  bench ("scattered", 64, 4099);
+  bench ("scattered", MAX_SIZE, 4099);
+
+  printf ("radix: PASS\n");
+}
+
+/* Checks the tree against the table in PAGES, as described at
+   the top of the file. */
+static void
+check (void) 
+{
+  struct radix_tree tree;
+  size_t present_cnt = 0;
+  size_t i, step;
+
+  printf ("checking:");
+  radix_init (&tree);
+  ASSERT (radix_lookup (&tree, 0) == NULL);
+  for (i = 0; i < CHECK_SIZE; i++)
+    {
+      /* Half small and dense, the rest anywhere, including both
+         ends of the range. */
+      if (i < CHECK_SIZE / 2)
+        pages[i].index = i * 3;
+      else if (i == CHECK_SIZE / 2)
+        pages[i].index = UINT32_MAX;
+      else
+        pages[i].index = random_ulong () << (random_ulong () % 24);
+      pages[i].present = false;
+      for (step = 0; step < i; step++)
+        if (pages[step].index == pages[i].index)
+          pages[i].index = i * 3 + 1;
+    }
+
+  for (step = 0; step < 16 * CHECK_SIZE; step++)
+    {
+      struct page *p = &pages[random_ulong () % CHECK_SIZE];
+
+      if (step % 1024 == 0)
+        printf (" %zu", step / 1024);
+      if (!p->present)
+        {
+          ASSERT (radix_insert (&tree, p->index, p));
+          p->present = true;
+          present_cnt++;
+        }
+      else
+        {
+          ASSERT (!radix_insert (&tree, p->index, p));
+          ASSERT (radix_delete (&tree, p->index) == p);
+          ASSERT (radix_delete (&tree, p->index) == NULL);
+          p->present = false;
+          present_cnt--;
+        }
+      ASSERT (radix_size (&tree) == present_cnt);
+
+      for (i = 0; i < CHECK_SIZE; i++)
+        ASSERT (radix_lookup (&tree, pages[i].index)
+                == (pages[i].present ? &pages[i] : NULL));
+      if (step % 64 == 0)
+        check_next (&tree, random_ulong () % 2 ? 0 : random_ulong ());
+    }
+
+  /* radix_destroy() visits every entry once. */
+  i = 0;
+  radix_destroy (&tree, count_action, &i);
+  ASSERT (i == present_cnt);
+  ASSERT (radix_empty (&tree) && radix_node_cnt (&tree) == 0);
+
+  /* Deleting every entry frees every node. */
+  for (i = 0; i < CHECK_SIZE; i++)
+    ASSERT (radix_insert (&tree, pages[i].index, &pages[i]));
+  for (i = 0; i < CHECK_SIZE; i++)
+    ASSERT (radix_delete (&tree, pages[i].index) == &pages[i]);
+  ASSERT (radix_empty (&tree) && radix_node_cnt (&tree) == 0);
+  printf (" done\n");
+}
+
+/* Checks that iterating over TREE with radix_lookup_next(),
+   starting from index START, visits exactly the present pages
+   at or after START, in order. */
+static void
+check_next (struct radix_tree *tree, uint32_t start) 
+{
+  size_t expected = 0, visited = 0;
+  uint32_t index, prev = 0;
+  struct page *p;
+  size_t i;
+
+  for (i = 0; i < CHECK_SIZE; i++)
+    if (pages[i].present && pages[i].index >= start)
+      expected++;
+
+  for (index = start; (p = radix_lookup_next (tree, &index)) != NULL; index++)
+    {
+      ASSERT (p->present && p->index == index && index >= start);
+      ASSERT (visited == 0 || index > prev);
+      prev = index;
+      visited++;
+      if (index == UINT32_MAX)
+        break;
+    }
+  ASSERT (visited == expected);
+}
+
+/* Counts the entries passed to it in the size_t that AUX points
+   to, checking that each is at the right index. */
+static void
+count_action (uint32_t index, void *item, void *aux) 
+{
+  struct page *p = item;
+  size_t *cnt = aux;
+
+  ASSERT (p->present && p->index == index);
+  (*cnt)++;
+}
+
+/* Times inserting, looking up, and deleting SIZE pages, whose
+   indexes are STRIDE apart, in a radix tree and a hash table,
+   and prints the cycles per operation for each, labeled NAME. */
+static void
+bench (const char *name, size_t size, uint32_t stride) 
+{
+  uint64_t cycles[3][2];
+  struct radix_tree tree;
+  struct hash hash;
+  uint64_t start;
+  size_t i, node_cnt;
+  int op;
+
+  for (i = 0; i < size; i++)
+    pages[i].index = i * stride;
+  radix_init (&tree);
+  hash_init (&hash, page_hash, page_less, NULL);
+
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (radix_insert (&tree, pages[i].index, &pages[i]));
+  cycles[0][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (hash_insert (&hash, &pages[i].hash_elem) == NULL);
+  cycles[0][1] = rdtsc () - start;
+  node_cnt = radix_node_cnt (&tree);
+
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (radix_lookup (&tree, pages[i].index) == &pages[i]);
+  cycles[1][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (hash_find (&hash, &pages[i].hash_elem) == &pages[i].hash_elem);
+  cycles[1][1] = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (radix_delete (&tree, pages[i].index) == &pages[i]);
+  cycles[2][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (hash_delete (&hash, &pages[i].hash_elem) == &pages[i].hash_elem);
+  cycles[2][1] = rdtsc () - start;
+  hash_destroy (&hash, NULL);
+
+  for (op = 0; op < 3; op++)
+    printf ("%-10s %6zu %-6s %8"PRIu64" %8"PRIu64"\n",
+            name, size, op == 0 ? "insert" : op == 1 ? "lookup" : "delete",
+            cycles[op][0] / size, cycles[op][1] / size);
+  printf ("%-10s %6zu radix tree nodes: %zu\n", name, size, node_cnt);
+}
+
+/* Returns a hash of page E's index. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct page, hash_elem)->index);
+}
+
+/* Returns true if page A's index is less than page B's. */
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+           void *aux UNUSED) 
+{
+  return (hash_entry (a, struct page, hash_elem)->index
+          < hash_entry (b, struct page, hash_elem)->index);
+}
@@ -0,0 +1,344 @@
+/* Test program and benchmark for lib/kernel/rbtree.c.
+
+   First inserts and removes values in random order, with many
+   duplicates, checking after each step that the tree is a valid
+   red-black tree, that traversal visits the values in order with
+   equal values in insertion order, and that rb_find(),
+   rb_lower_bound(), and rb_upper_bound() agree with a search of
+   the sorted values.
+
+   Then compares the cycles per operation of a red-black tree, a
+   list kept sorted with list_insert_ordered(), and a hash table,
+   for inserting values in random order, finding each of them,
+   and removing them smallest first.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <list.h>
+#include <random.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "threads/tsc.h"
+
+/* Number of values in the correctness test. */
+#define CHECK_SIZE 512
+
+/* Largest number of values to time. */
+#define MAX_SIZE 4096
+
+/* A value in a tree, list, and hash table at once. */
+struct value 
+  {
+    struct rb_node rb_node;     /* Tree node. */
+    struct list_elem list_elem; /* List element. */
+    struct hash_elem hash_elem; /* Hash table element. */
+    int key;                    /* Sort key. */
+    int seq;                    /* Insertion order among equal keys. */
+    bool in_tree;               /* Currently in the tree? */
+  };
+
+static struct value values[MAX_SIZE];
+
+static void check (void);
+static void bench (size_t size);
+static void shuffle (struct value *[], size_t);
+static int verify_subtree (const struct rb_node *, const struct rb_node *parent);
+static void verify_tree (struct rb_tree *, size_t size);
+static rb_less_func value_rb_less;
+static list_less_func value_list_less;
+static hash_hash_func value_hash;
+static hash_less_func value_hash_less;
+
+/* Tests and benchmarks the red-black tree. */
+void
+test (void) 
+{
+  static const size_t sizes[] = {16, 256, 1024, MAX_SIZE};
+  size_t i;
+
+  check ();
+
+  printf ("cycles per operation:\n");
+  printf ("%6s %-7s %8s %8s %8s\n", "size", "op", "rbtree", "list", "hash");
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    bench (sizes[i]);
+
+  printf ("rbtree: PASS\n");
+}
+
+/* Checks the tree against the sorted values, as described at the
+   top of the file. */
+static void
+check (void) 
+{
+  static struct value *order[CHECK_SIZE];
+  struct rb_tree tree;
+  int round, i, seq;
+
+  printf ("checking:");
+  rb_init (&tree, value_rb_less, NULL);
+  for (i = 0; i < CHECK_SIZE; i++) 
+    {
+      values[i].key = i / 4;
+      values[i].in_tree = false;
+      order[i] = &values[i];
+    }
+
+  seq = 0;
+  for (round = 0; round < 8; round++) 
+    {
+      printf (" %d", round);
+
+      /* Insert everything in random order, then remove a random
+         half, then put it back, checking as we go. */
+      shuffle (order, CHECK_SIZE);
+      for (i = 0; i < CHECK_SIZE; i++) 
+        {
+          if (!order[i]->in_tree) 
+            {
+              order[i]->seq = seq++;
+              order[i]->in_tree = true;
+              rb_insert (&tree, &order[i]->rb_node);
+            }
+          verify_tree (&tree, CHECK_SIZE);
+        }
+      shuffle (order, CHECK_SIZE);
+      for (i = 0; i < CHECK_SIZE / 2; i++) 
+        {
+          if (i % 8 == 0)
+            {
+              /* verify_tree() has checked that the minimum is
+                 the first-inserted of the smallest values. */
+              struct value *v = rb_entry (rb_pop_min (&tree),
+                                          struct value, rb_node);
+              ASSERT (v->in_tree);
+              v->in_tree = false;
+            }
+          else if (order[i]->in_tree)
+            {
+              rb_remove (&tree, &order[i]->rb_node);
+              order[i]->in_tree = false;
+            }
+          verify_tree (&tree, CHECK_SIZE);
+        }
+    }
+
+  while (!rb_empty (&tree))
+    rb_pop_min (&tree);
+  ASSERT (rb_size (&tree) == 0);
+  ASSERT (rb_min (&tree) == NULL && rb_max (&tree) == NULL);
+  printf (" done\n");
+}
+
+/* Verifies that TREE is a valid red-black tree holding exactly
+   the values among the first SIZE that are marked in_tree. */
+static void
+verify_tree (struct rb_tree *tree, size_t size) 
+{
+  struct rb_node *n, *prev, *lower, *upper;
+  struct value key;
+  size_t cnt, i;
+
+  ASSERT (tree->root == NULL || !tree->root->red);
+  ASSERT (tree->root == NULL || tree->root->parent == NULL);
+  verify_subtree (tree->root, NULL);
+
+  /* Forward traversal is in order, FIFO among equal keys. */
+  cnt = 0;
+  prev = NULL;
+  for (n = rb_min (tree); n != NULL; n = rb_next (n))
+    {
+      const struct value *v = rb_entry (n, struct value, rb_node);
+      ASSERT (v->in_tree);
+      if (prev != NULL)
+        {
+          const struct value *p = rb_entry (prev, struct value, rb_node);
+          ASSERT (p->key < v->key || (p->key == v->key && p->seq < v->seq));
+        }
+      ASSERT (rb_prev (n) == prev);
+      prev = n;
+      cnt++;
+    }
+  ASSERT (prev == rb_max (tree));
+  ASSERT (cnt == rb_size (tree));
+  for (i = 0; i < size; i++)
+    if (values[i].in_tree)
+      cnt--;
+  ASSERT (cnt == 0);
+
+  /* Searches agree with a linear scan. */
+  key.key = (int) (random_ulong () % (size / 4 + 2)) - 1;
+  lower = upper = NULL;
+  for (n = rb_min (tree); n != NULL; n = rb_next (n))
+    {
+      int k = rb_entry (n, struct value, rb_node)->key;
+      if (lower == NULL && k >= key.key)
+        lower = n;
+      if (upper == NULL && k > key.key)
+        upper = n;
+    }
+  ASSERT (rb_lower_bound (tree, &key.rb_node) == lower);
+  ASSERT (rb_upper_bound (tree, &key.rb_node) == upper);
+  ASSERT (rb_find (tree, &key.rb_node)
+          == (lower != NULL
+              && rb_entry (lower, struct value, rb_node)->key == key.key
+              ? lower : NULL));
+}
+
+/* Verifies the subtree rooted at N, whose parent should be
+   PARENT: no red node has a red child, each node's children
+   point back to it, and every path down has the same number of
+   black nodes, which is returned. */
+static int
+verify_subtree (const struct rb_node *n, const struct rb_node *parent) 
+{
+  int left, right;
+
+  if (n == NULL)
+    return 1;
+  ASSERT (n->parent == parent);
+  ASSERT (!n->red || ((n->left == NULL || !n->left->red)
+                       && (n->right == NULL || !n->right->red)));
+  left = verify_subtree (n->left, n);
+  right = verify_subtree (n->right, n);
+  ASSERT (left == right);
+  return left + !n->red;
+}
+
+/* Times inserting, finding, and removing the first SIZE values
+   in a tree, a sorted list, and a hash table, and prints the
+   cycles per operation for each. */
+static void
+bench (size_t size) 
+{
+  static struct value *order[MAX_SIZE];
+  uint64_t cycles[3][3];
+  struct rb_tree tree;
+  struct list list;
+  struct hash hash;
+  uint64_t start;
+  size_t i;
+  int op;
+
+  for (i = 0; i < size; i++) 
+    {
+      values[i].key = i;
+      order[i] = &values[i];
+    }
+  shuffle (order, size);
+  rb_init (&tree, value_rb_less, NULL);
+  list_init (&list);
+  hash_init (&hash, value_hash, value_hash_less, NULL);
+
+  /* Insert in random order. */
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    rb_insert (&tree, &order[i]->rb_node);
+  cycles[0][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    list_insert_ordered (&list, &order[i]->list_elem, value_list_less, NULL);
+  cycles[0][1] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    hash_insert (&hash, &order[i]->hash_elem);
+  cycles[0][2] = rdtsc () - start;
+
+  /* Find each value. */
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (rb_find (&tree, &order[i]->rb_node) == &order[i]->rb_node);
+  cycles[1][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    {
+      struct list_elem *e = list_begin (&list);
+      while (value_list_less (e, &order[i]->list_elem, NULL))
+        e = list_next (e);
+      ASSERT (e == &order[i]->list_elem);
+    }
+  cycles[1][1] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (hash_find (&hash, &order[i]->hash_elem) == &order[i]->hash_elem);
+  cycles[1][2] = rdtsc () - start;
+
+  /* Remove smallest first.  A hash table has no order, so it has
+     to look for the smallest remaining value each time; instead
+     it gets the values already sorted, which flatters it. */
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (rb_pop_min (&tree) == &values[i].rb_node);
+  cycles[2][0] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (list_pop_front (&list) == &values[i].list_elem);
+  cycles[2][1] = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < size; i++)
+    ASSERT (hash_delete (&hash, &values[i].hash_elem)
+            == &values[i].hash_elem);
+  cycles[2][2] = rdtsc () - start;
+  hash_destroy (&hash, NULL);
+
+  for (op = 0; op < 3; op++)
+    printf ("%6zu %-7s %8"PRIu64" %8"PRIu64" %8"PRIu64"\n",
+            size, op == 0 ? "insert" : op == 1 ? "find" : "pop-min",
+            cycles[op][0] / size, cycles[op][1] / size, cycles[op][2] / size);
+}
+
+/* Shuffles the CNT pointers in ARRAY into random order. */
+static void
+shuffle (struct value **array, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t j = i + random_ulong () % (cnt - i);
+      struct value *t = array[j];
+      array[j] = array[i];
+      array[i] = t;
+    }
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_rb_less (const struct rb_node *a, const struct rb_node *b,
+               void *aux UNUSED) 
+{
+  return (rb_entry (a, struct value, rb_node)->key
+          < rb_entry (b, struct value, rb_node)->key);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_list_less (const struct list_elem *a, const struct list_elem *b,
+                 void *aux UNUSED) 
+{
+  return (list_entry (a, struct value, list_elem)->key
+          < list_entry (b, struct value, list_elem)->key);
+}
+
+/* Returns a hash of value E's key. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct value, hash_elem)->key);
+}
+
+/* Returns true if value A's key is less than value B's. */
+static bool
+value_hash_less (const struct hash_elem *a, const struct hash_elem *b,
+                 void *aux UNUSED) 
+{
+  return (hash_entry (a, struct value, hash_elem)->key
+          < hash_entry (b, struct value, hash_elem)->key);
+}
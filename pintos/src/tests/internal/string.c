@@ -0,0 +1,162 @@
+/* Test program and benchmark for the memory block functions in
+   lib/string.c.
+
+   First checks memcpy(), memmove(), memset() and memcmp()
+   against simple byte-at-a-time versions for many sizes, source
+   and destination alignments, and (for memmove()) overlaps.
+   Then prints how many bytes per 100 cycles each function
+   handles, at several sizes and alignments.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "threads/tsc.h"
+
+/* Largest block to check or time. */
+#define MAX_SIZE 4096
+
+/* Times to repeat each timed call. */
+#define REPEAT 64
+
+static uint8_t buf_a[MAX_SIZE + 64], buf_b[MAX_SIZE + 64];
+static uint8_t ref[MAX_SIZE + 64];
+
+static void check (void);
+static void bench (int func, size_t size, size_t align);
+
+/* Tests and benchmarks the memory block functions. */
+void
+test (void) 
+{
+  static const size_t sizes[] = {8, 64, 256, 1024, MAX_SIZE};
+  static const size_t aligns[] = {0, 1, 3};
+  static const char *names[] = {"memcpy", "memmove", "memset", "memcmp"};
+  size_t s, a;
+  int f;
+
+  check ();
+
+  printf ("bytes per 100 cycles at sizes");
+  for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+    printf (" %zu", sizes[s]);
+  printf (":\n");
+  for (f = 0; f < 4; f++)
+    for (a = 0; a < sizeof aligns / sizeof *aligns; a++)
+      {
+        printf ("%-8s align %zu:", names[f], aligns[a]);
+        for (s = 0; s < sizeof sizes / sizeof *sizes; s++)
+          bench (f, sizes[s], aligns[a]);
+        printf ("\n");
+      }
+
+  printf ("string: PASS\n");
+}
+
+/* Fills BUF with random bytes. */
+static void
+randomize (uint8_t *buf, size_t size) 
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = random_ulong ();
+}
+
+/* Checks each function against a byte-at-a-time version. */
+static void
+check (void) 
+{
+  size_t size, src_ofs, dst_ofs, i;
+
+  printf ("checking:");
+  for (size = 0; size <= 600; size = size < 16 ? size + 1 : size * 3 / 2)
+    {
+      printf (" %zu", size);
+      for (src_ofs = 0; src_ofs < 8; src_ofs++)
+        for (dst_ofs = 0; dst_ofs < 8; dst_ofs++) 
+          {
+            /* memcpy() between distinct buffers. */
+            randomize (buf_a, sizeof buf_a);
+            randomize (buf_b, sizeof buf_b);
+            memcpy (ref, buf_b, sizeof ref);
+            for (i = 0; i < size; i++)
+              ref[dst_ofs + i] = buf_a[src_ofs + i];
+            ASSERT (memcpy (buf_b + dst_ofs, buf_a + src_ofs, size)
+                    == buf_b + dst_ofs);
+            ASSERT (memcmp (buf_b, ref, sizeof ref) == 0);
+
+            /* memmove() within one buffer, overlapping. */
+            memcpy (ref, buf_b, sizeof ref);
+            if (dst_ofs < src_ofs)
+              for (i = 0; i < size; i++)
+                ref[dst_ofs + i] = ref[src_ofs + i];
+            else
+              for (i = size; i-- > 0; )
+                ref[dst_ofs + i] = ref[src_ofs + i];
+            ASSERT (memmove (buf_b + dst_ofs, buf_b + src_ofs, size)
+                    == buf_b + dst_ofs);
+            ASSERT (memcmp (buf_b, ref, sizeof ref) == 0);
+
+            /* memset(). */
+            for (i = 0; i < size; i++)
+              ref[dst_ofs + i] = src_ofs * 37;
+            ASSERT (memset (buf_b + dst_ofs, src_ofs * 37, size)
+                    == buf_b + dst_ofs);
+            ASSERT (memcmp (buf_b, ref, sizeof ref) == 0);
+
+            /* memcmp(), equal and with one differing byte. */
+            memcpy (buf_b + dst_ofs, buf_a + src_ofs, size);
+            ASSERT (memcmp (buf_a + src_ofs, buf_b + dst_ofs, size) == 0);
+            if (size > 0) 
+              {
+                i = random_ulong () % size;
+                buf_b[dst_ofs + i] = buf_a[src_ofs + i] + 1;
+                ASSERT ((memcmp (buf_a + src_ofs, buf_b + dst_ofs, size) < 0)
+                        == (buf_a[src_ofs + i] < buf_b[dst_ofs + i]));
+              }
+          }
+    }
+  printf (" done\n");
+}
+
+/* Times function FUNC (0 for memcpy(), 1 for memmove(), 2 for
+   memset(), 3 for memcmp()) on SIZE-byte blocks whose addresses
+   are ALIGN bytes past a word boundary, and prints the bytes
+   handled per 100 cycles. */
+static void
+bench (int func, size_t size, size_t align) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  memcpy (buf_b, buf_a, sizeof buf_b);
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    switch (func) 
+      {
+      case 0:
+        memcpy (buf_b + align, buf_a + align, size);
+        break;
+      case 1:
+        memmove (buf_b + align + 1, buf_b + align, size);
+        break;
+      case 2:
+        memset (buf_b + align, i, size);
+        break;
+      case 3:
+        ASSERT (memcmp (buf_a + align, buf_b + align, size) == 0);
+        break;
+      }
+  cycles = rdtsc () - start;
+  if (cycles == 0)
+    cycles = 1;
+  printf (" %5"PRIu64, (uint64_t) size * REPEAT * 100 / cycles);
+}
@@ -0,0 +1,74 @@
+/* Puts thousands of threads to sleep with deadlines spread over
+   a few hundred ticks, checks that none of them wakes early, and
+   reports how many cycles the timer interrupt handler spends per
+   tick while they sleep.  With a deadline-ordered sleep queue
+   the handler's cost should depend on how many threads wake in a
+   tick, not on how many are asleep. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 2000        /* Number of sleeping threads. */
+#define SPREAD 200              /* Deadlines span this many ticks. */
+
+/* Tick at which the sleepers' deadlines start. */
+static int64_t base;
+
+/* Upped by each sleeper after it wakes. */
+static struct semaphore done;
+
+static thread_func sleeper;
+
+void
+test_alarm_stress (void) 
+{
+  struct timer_intr_stats stats;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+
+  /* The sleepers have lower priority than us, so none of them
+     runs until we block below, after BASE has been set. */
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT - 1, sleeper, (void *) i)
+          == TID_ERROR)
+        fail ("could not create %d sleepers", SLEEPER_CNT);
+    }
+
+  base = timer_ticks () + 10;
+  timer_reset_intr_stats ();
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done);
+  timer_get_intr_stats (&stats);
+
+  msg ("%d sleepers woke on time.", SLEEPER_CNT);
+  if (stats.count > 0)
+    msg ("timer interrupt: %"PRId64" ticks, %"PRIu64" cycles average, "
+         "%"PRIu64" cycles max",
+         stats.count, stats.total_cycles / stats.count, stats.max_cycles);
+}
+
+/* Sleeps until its deadline and checks that it did not wake
+   early. */
+static void
+sleeper (void *aux) 
+{
+  int64_t deadline = base + (int) aux % SPREAD;
+
+  timer_sleep (deadline - timer_ticks ());
+  if (timer_ticks () < deadline)
+    fail ("%s woke up at tick %"PRId64", before its deadline %"PRId64,
+          thread_name (), timer_ticks (), deadline);
+  sema_up (&done);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Not all sleepers woke up.\n"
+  if !grep (/\d+ sleepers woke on time\./, @output);
+fail "Missing timer interrupt statistics.\n"
+  if !grep (/timer interrupt: \d+ ticks, \d+ cycles average, \d+ cycles max/,
+	    @output);
+pass;
@@ -0,0 +1,126 @@
+/* Microbenchmark for bitmap scanning.
+
+   Builds a 1,048,576-bit map in which every 8th bit is set and
+   the others are set at random, so that there is no run of more
+   than 7 clear bits, except for 64 clear bits at the very end.
+   Scanning for 8 or 32 clear bits must therefore look at the
+   whole map.  Compares bitmap_scan() against a bit-at-a-time
+   scan, checking that they agree and reporting the cycles each
+   took.
+
+   Then allocates single bits one after another, first always
+   scanning from the start of the map and then with a next-fit
+   cursor, and reports the cycles per allocation. */
+
+#include <bitmap.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/tsc.h"
+
+#define BIT_CNT (1024 * 1024)   /* Bits in the map. */
+#define TAIL_CNT 64             /* Clear bits at the end. */
+#define ALLOC_CNT 1000          /* Single-bit allocations to time. */
+
+static struct bitmap *make_map (void);
+static size_t slow_scan (const struct bitmap *, size_t cnt, bool value);
+static void measure_alloc (bool next_fit);
+
+void
+test_bitmap_scan (void) 
+{
+  static const size_t cnts[] = {8, 32};
+  struct bitmap *b = make_map ();
+  size_t i;
+
+  for (i = 0; i < sizeof cnts / sizeof *cnts; i++)
+    {
+      uint64_t start, fast_cycles, slow_cycles;
+      size_t fast, slow;
+
+      start = rdtsc ();
+      fast = bitmap_scan (b, 0, cnts[i], false);
+      fast_cycles = rdtsc () - start;
+
+      start = rdtsc ();
+      slow = slow_scan (b, cnts[i], false);
+      slow_cycles = rdtsc () - start;
+
+      msg ("Scan for %zu clear bits finds the tail: %s.", cnts[i],
+           fast == slow && fast == BIT_CNT - TAIL_CNT ? "yes" : "no");
+      msg ("scan for %zu: %"PRIu64" cycles word-at-a-time, "
+           "%"PRIu64" cycles bit-at-a-time", cnts[i], fast_cycles, slow_cycles);
+    }
+  bitmap_destroy (b);
+
+  measure_alloc (false);
+  measure_alloc (true);
+}
+
+/* Returns a new map with the pattern described at the top of
+   the file. */
+static struct bitmap *
+make_map (void) 
+{
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i;
+
+  if (b == NULL)
+    fail ("bitmap_create failed");
+  random_init (0);
+  for (i = 0; i < BIT_CNT - TAIL_CNT; i++)
+    if (i % 8 == 0 || random_ulong () % 2)
+      bitmap_mark (b, i);
+  return b;
+}
+
+/* Finds the first run of CNT bits set to VALUE in B the way
+   bitmap_scan() used to, by testing every bit at every
+   position. */
+static size_t
+slow_scan (const struct bitmap *b, size_t cnt, bool value) 
+{
+  size_t i, j;
+
+  for (i = 0; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Allocates ALLOC_CNT single bits from a map whose first half
+   is full, with a next-fit cursor if NEXT_FIT is true or by
+   always scanning from the beginning otherwise, and reports the
+   cycles per allocation. */
+static void
+measure_alloc (bool next_fit) 
+{
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t cursor = 0;
+  uint64_t start;
+  int i;
+
+  if (b == NULL)
+    fail ("bitmap_create failed");
+  bitmap_set_multiple (b, 0, BIT_CNT / 2, true);
+
+  start = rdtsc ();
+  for (i = 0; i < ALLOC_CNT; i++)
+    {
+      size_t idx = (next_fit
+                    ? bitmap_scan_and_flip_next (b, &cursor, 1, false)
+                    : bitmap_scan_and_flip (b, 0, 1, false));
+      if (idx != BIT_CNT / 2 + (size_t) i)
+        fail ("allocation %d returned bit %zu", i, idx);
+    }
+  msg ("%s: %"PRIu64" cycles per allocation",
+       next_fit ? "next fit" : "first fit", (rdtsc () - start) / ALLOC_CNT);
+  bitmap_destroy (b);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $cnt (8, 32) {
+    fail "Scan for $cnt clear bits did not find the tail.\n"
+      if !grep (/Scan for $cnt clear bits finds the tail: yes\./, @output);
+    fail "Missing timing for scan for $cnt.\n"
+      if !grep (/scan for $cnt: \d+ cycles word-at-a-time, \d+ cycles/,
+		@output);
+}
+foreach my $what ('first fit', 'next fit') {
+    fail "Missing allocation timing for $what.\n"
+      if !grep (/$what: \d+ cycles per allocation/, @output);
+}
+pass;
@@ -0,0 +1,128 @@
+/* Checks the earliest-deadline-first scheduling class.
+
+   First, with 60% of the CPU reserved by the main thread,
+   admission control must reject another thread's request for 50%
+   but accept one for 30%.
+
+   Then an EDF thread with the lowest priority, reserving 2 ticks
+   in every 10, competes for 50 ticks with a PRI_MAX thread that
+   never blocks.  The EDF thread must preempt the PRI_MAX thread
+   at the start of every period but be throttled once it has used
+   its 2 ticks, so it should run for about 10 of the 50 ticks.
+
+   Finally, the EDF thread's reservation must have been released
+   when it exited. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct admission_info
+  {
+    bool admitted[2];           /* Results of the two requests. */
+    struct semaphore done;      /* Upped when finished. */
+  };
+
+struct spin_info
+  {
+    int64_t start;              /* Tick to start spinning. */
+    int64_t end;                /* Tick to stop spinning. */
+    int ticks;                  /* Ticks observed while spinning. */
+    struct semaphore done;      /* Upped when finished. */
+  };
+
+static thread_func admission_thread;
+static thread_func edf_thread;
+static thread_func hog_thread;
+static void spin (struct spin_info *);
+
+void
+test_edf (void)
+{
+  struct admission_info ai;
+  struct spin_info edf, hog;
+
+  /* Admission control. */
+  if (!thread_set_deadline (6, 10, 10))
+    fail ("Request for 60%% rejected.");
+  sema_init (&ai.done, 0);
+  thread_create ("admission", PRI_DEFAULT, admission_thread, &ai);
+  sema_down (&ai.done);
+  thread_set_deadline (0, 0, 0);
+  msg ("Request for 50%% with 60%% reserved admitted: %s.",
+       ai.admitted[0] ? "yes" : "no");
+  msg ("Request for 30%% with 60%% reserved admitted: %s.",
+       ai.admitted[1] ? "yes" : "no");
+
+  /* Budget enforcement and preemption. */
+  edf.start = hog.start = timer_ticks () + 10;
+  edf.end = hog.end = edf.start + 50;
+  edf.ticks = hog.ticks = 0;
+  sema_init (&edf.done, 0);
+  sema_init (&hog.done, 0);
+  thread_create ("edf", PRI_MIN, edf_thread, &edf);
+  thread_create ("hog", PRI_MAX, hog_thread, &hog);
+  sema_down (&edf.done);
+  sema_down (&hog.done);
+  msg ("EDF thread ran for 5 to 15 of 50 ticks: %s.",
+       edf.ticks >= 5 && edf.ticks <= 15 ? "yes" : "no");
+  msg ("PRI_MAX thread ran for at least 30 of 50 ticks: %s.",
+       hog.ticks >= 30 ? "yes" : "no");
+
+  /* Release on exit. */
+  timer_sleep (1);
+  msg ("Request for 90%% after EDF thread exited admitted: %s.",
+       thread_set_deadline (9, 10, 10) ? "yes" : "no");
+  thread_set_deadline (0, 0, 0);
+}
+
+static void
+admission_thread (void *ai_)
+{
+  struct admission_info *ai = ai_;
+
+  ai->admitted[0] = thread_set_deadline (5, 10, 10);
+  ai->admitted[1] = thread_set_deadline (3, 10, 10);
+  thread_set_deadline (0, 0, 0);
+  sema_up (&ai->done);
+}
+
+static void
+edf_thread (void *si_)
+{
+  struct spin_info *si = si_;
+
+  if (!thread_set_deadline (2, 10, 10))
+    fail ("Request for 20%% rejected.");
+  spin (si);
+  sema_up (&si->done);
+}
+
+static void
+hog_thread (void *si_)
+{
+  struct spin_info *si = si_;
+
+  spin (si);
+  sema_up (&si->done);
+}
+
+/* Sleeps until SI->start, then busy-waits until SI->end, counting
+   the ticks during which this thread got to run. */
+static void
+spin (struct spin_info *si)
+{
+  int64_t last = 0;
+  int64_t now;
+
+  timer_sleep (si->start - timer_ticks ());
+  while ((now = timer_ticks ()) < si->end)
+    {
+      if (now != last)
+        si->ticks++;
+      last = now;
+    }
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf) begin
+(edf) Request for 50% with 60% reserved admitted: no.
+(edf) Request for 30% with 60% reserved admitted: yes.
+(edf) EDF thread ran for 5 to 15 of 50 ticks: yes.
+(edf) PRI_MAX thread ran for at least 30 of 50 ticks: yes.
+(edf) Request for 90% after EDF thread exited admitted: yes.
+(edf) end
+EOF
+pass;
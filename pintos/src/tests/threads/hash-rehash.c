@@ -0,0 +1,182 @@
+/* Checks that a hash table stays correct while it grows and
+   shrinks incrementally, and measures the cost of insertions.
+
+   Inserts ELEM_CNT elements into an empty table, reporting the
+   worst-case cycles for a single insertion, then checks that
+   every element can be found, deletes every other one, and
+   checks the table again.
+
+   Does this three times: with the table growing incrementally;
+   with the table resized all at once whenever it would grow, as
+   it used to be, by calling hash_reserve() at those points; and
+   with a table that hash_reserve() has sized in advance, which
+   should never need to resize.  Growing incrementally should
+   keep the worst insertion well below the all-at-once case.
+   Each case runs RUN_CNT times and reports its lowest worst
+   insertion, so that a single interrupt cannot decide it. */
+
+#include <hash.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/tsc.h"
+
+#define ELEM_CNT 16384          /* Elements to insert. */
+#define RUN_CNT 3               /* Runs of each case. */
+
+struct value 
+  {
+    struct hash_elem elem;      /* Hash table element. */
+    int key;                    /* Key. */
+  };
+
+static struct value values[ELEM_CNT];
+
+/* How the table is sized. */
+enum mode
+  {
+    GROWING,                    /* Grows incrementally. */
+    ALL_AT_ONCE,                /* Resized all at once when full. */
+    RESERVED                    /* Sized in advance. */
+  };
+
+static hash_hash_func value_hash;
+static hash_less_func value_less;
+static const char *names[] = {"growing", "all-at-once", "reserved"};
+
+static uint64_t run (enum mode, bool report);
+static void check (struct hash *, int stride);
+
+void
+test_hash_rehash (void) 
+{
+  uint64_t worst[3];
+  int mode, i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    values[i].key = i;
+  for (mode = GROWING; mode <= RESERVED; mode++)
+    {
+      worst[mode] = UINT64_MAX;
+      for (i = 0; i < RUN_CNT; i++)
+        {
+          uint64_t cycles = run (mode, i == RUN_CNT - 1);
+          if (cycles < worst[mode])
+            worst[mode] = cycles;
+        }
+      msg ("%s: worst insertion %"PRIu64" cycles", names[mode], worst[mode]);
+    }
+  msg ("Worst incremental insertion below worst all-at-once: %s.",
+       worst[GROWING] < worst[ALL_AT_ONCE] ? "yes" : "no");
+}
+
+/* Runs the test described at the top of the file once, sizing
+   the table according to MODE, and returns the worst insertion's
+   cycles.  Reports on the table if REPORT is true. */
+static uint64_t
+run (enum mode mode, bool report) 
+{
+  const char *name = names[mode];
+  struct hash h;
+  struct hash_stats st;
+  uint64_t max_cycles = 0;
+  size_t resize_cnt;
+  size_t bucket_cnt = 4;
+  int i;
+
+  if (!hash_init (&h, value_hash, value_less, NULL))
+    fail ("hash_init failed");
+  if (mode == RESERVED && !hash_reserve (&h, ELEM_CNT))
+    fail ("hash_reserve failed");
+  hash_get_stats (&h, &st);
+  resize_cnt = st.resize_cnt;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      uint64_t start = rdtsc ();
+      struct hash_elem *old;
+      uint64_t cycles;
+
+      /* Where the table would start to grow, resize it
+         synchronously to the size it would grow to, so that it
+         never grows incrementally. */
+      if (mode == ALL_AT_ONCE && (size_t) i + 1 > bucket_cnt * 4)
+        {
+          if (!hash_reserve (&h, i + 1))
+            fail ("hash_reserve failed");
+          while (bucket_cnt < (size_t) (i + 1) / 2)
+            bucket_cnt *= 2;
+        }
+      old = hash_insert (&h, &values[i].elem);
+      cycles = rdtsc () - start;
+
+      if (old != NULL)
+        fail ("%s: inserting %d found an equal element", name, i);
+      if (cycles > max_cycles)
+        max_cycles = cycles;
+    }
+  check (&h, 1);
+
+  hash_get_stats (&h, &st);
+  if (report)
+    {
+      msg ("%s: resized during insertion: %s.", name,
+           st.resize_cnt > resize_cnt ? "yes" : "no");
+      msg ("%s: %zu buckets, longest chain %zu",
+           name, st.bucket_cnt, st.max_chain);
+    }
+
+  for (i = 1; i < ELEM_CNT; i += 2)
+    if (hash_delete (&h, &values[i].elem) != &values[i].elem)
+      fail ("%s: deleting %d failed", name, i);
+  check (&h, 2);
+
+  hash_destroy (&h, NULL);
+  if (report)
+    msg ("%s: all checks passed.", name);
+  return max_cycles;
+}
+
+/* Checks that hash table H contains exactly the elements of
+   VALUES whose index is a multiple of STRIDE, and that its
+   statistics are consistent. */
+static void
+check (struct hash *h, int stride) 
+{
+  struct hash_stats st;
+  size_t chain_cnt;
+  int i;
+
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      bool found = hash_find (h, &values[i].elem) == &values[i].elem;
+      if (found != (i % stride == 0))
+        fail ("element %d %s", i, found ? "found" : "not found");
+    }
+
+  hash_get_stats (h, &st);
+  if (st.elem_cnt != (size_t) ELEM_CNT / stride)
+    fail ("table has %zu elements, expected %d",
+          st.elem_cnt, ELEM_CNT / stride);
+  chain_cnt = 0;
+  for (i = 0; i < HASH_CHAIN_HIST; i++)
+    chain_cnt += st.chain_hist[i];
+  if (chain_cnt != st.bucket_cnt)
+    fail ("chain histogram covers %zu of %zu buckets",
+          chain_cnt, st.bucket_cnt);
+}
+
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct value, elem)->key);
+}
+
+static bool
+value_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED) 
+{
+  return (hash_entry (a, struct value, elem)->key
+          < hash_entry (b, struct value, elem)->key);
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $name ('growing', 'all-at-once') {
+    fail "\u$name table never resized.\n"
+      if !grep (/$name: resized during insertion: yes\./, @output);
+}
+fail "Reserved table resized.\n"
+  if !grep (/reserved: resized during insertion: no\./, @output);
+foreach my $name ('growing', 'all-at-once', 'reserved') {
+    fail "Missing statistics for $name table.\n"
+      if !grep (/$name: \d+ buckets, longest chain \d+$/, @output)
+	 || !grep (/$name: worst insertion \d+ cycles/, @output);
+    fail "Checks failed for $name table.\n"
+      if !grep (/$name: all checks passed\./, @output);
+}
+fail "Incremental resizing did not lower the worst insertion.\n"
+  if !grep (/Worst incremental insertion below worst all-at-once: yes\./,
+	    @output);
+pass;
@@ -0,0 +1,102 @@
+/* Checks the TSC-based nanosecond clock and sub-tick sleeps.
+
+   The clock must never go backward and must agree with the
+   timer tick.  Sleeps of 500 microseconds must last at least
+   that long, and 20 of them must take well under the 20 ticks
+   that rounding each up to a tick would, both while the CPU is
+   otherwise idle and while a lower-priority thread is ready to
+   run.  That thread must get to run while the main thread
+   sleeps, showing that the sleeps block instead of
+   busy-waiting. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+#define SLEEP_US 500
+
+static thread_func counter_thread;
+static void time_sleeps (const char *);
+static volatile bool stop;
+static volatile int counter;
+
+void
+test_hires_sleep (void)
+{
+  struct semaphore done;
+  bool monotonic = true;
+  int64_t prev, start, elapsed;
+  int i;
+
+  /* Monotonicity. */
+  prev = timer_ns ();
+  for (i = 0; i < 10000; i++)
+    {
+      int64_t now = timer_ns ();
+      if (now < prev)
+        monotonic = false;
+      prev = now;
+    }
+  msg ("Clock never went backward: %s.", monotonic ? "yes" : "no");
+
+  /* Agreement with timer ticks.  timer_sleep (10) returns at the
+     10th tick after the current one, 90 to 100 ms from now. */
+  start = timer_ns ();
+  timer_sleep (10);
+  elapsed = timer_ns () - start;
+  msg ("10 ticks took 85 to 120 ms: %s.",
+       elapsed >= 85000000 && elapsed <= 120000000 ? "yes" : "no");
+
+  /* Precision while idle. */
+  time_sleeps ("idle");
+
+  /* Precision and yielding while another thread is ready.  The
+     sleeps must end at their deadlines, not at the next tick. */
+  sema_init (&done, 0);
+  thread_create ("counter", PRI_DEFAULT - 1, counter_thread, &done);
+  time_sleeps ("busy");
+  stop = true;
+  sema_down (&done);
+  msg ("Lower-priority thread ran during sleeps: %s.",
+       counter > 0 ? "yes" : "no");
+}
+
+/* Sleeps SLEEP_CNT times for SLEEP_US microseconds each and
+   reports whether each sleep lasted long enough and all of them
+   together took less than 5 ticks.  WHEN describes what else
+   the CPU has to do. */
+static void
+time_sleeps (const char *when) 
+{
+  bool long_enough = true;
+  int64_t start, elapsed;
+  int i;
+
+  start = timer_ns ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      int64_t t0 = timer_ns ();
+      timer_usleep (SLEEP_US);
+      if (timer_ns () - t0 < SLEEP_US * 1000)
+        long_enough = false;
+    }
+  elapsed = timer_ns () - start;
+  msg ("%s: each sleep lasted at least %d us: %s.", when, SLEEP_US,
+       long_enough ? "yes" : "no");
+  msg ("%s: %d sleeps took less than 5 ticks: %s.", when, SLEEP_CNT,
+       elapsed < 5 * (1000000000 / TIMER_FREQ) ? "yes" : "no");
+}
+
+static void
+counter_thread (void *done_)
+{
+  struct semaphore *done = done_;
+
+  while (!stop)
+    counter++;
+  sema_up (done);
+}
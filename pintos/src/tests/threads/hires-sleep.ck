@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(hires-sleep) begin
+(hires-sleep) Clock never went backward: yes.
+(hires-sleep) 10 ticks took 85 to 120 ms: yes.
+(hires-sleep) idle: each sleep lasted at least 500 us: yes.
+(hires-sleep) idle: 20 sleeps took less than 5 ticks: yes.
+(hires-sleep) busy: each sleep lasted at least 500 us: yes.
+(hires-sleep) busy: 20 sleeps took less than 5 ticks: yes.
+(hires-sleep) Lower-priority thread ran during sleeps: yes.
+(hires-sleep) end
+EOF
+pass;
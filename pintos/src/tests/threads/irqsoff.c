@@ -0,0 +1,29 @@
+/* Turns interrupts off for at least 10,000,000 cycles, by the
+   TSC, and checks that the -irqsoff tracer saw a section at least
+   that long. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/tsc.h"
+
+#define SPIN_CYCLES 10000000
+
+void
+test_irqsoff (void)
+{
+  enum intr_level old_level;
+  uint64_t start;
+
+  ASSERT (intr_trace_irqsoff);
+
+  old_level = intr_disable ();
+  start = rdtsc ();
+  while (rdtsc () - start < SPIN_CYCLES)
+    continue;
+  intr_set_level (old_level);
+
+  msg ("Longest interrupts-off section at least %d cycles: %s.",
+       SPIN_CYCLES, intr_irqsoff_max () >= SPIN_CYCLES ? "yes" : "no");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(irqsoff) begin
+(irqsoff) Longest interrupts-off section at least 10000000 cycles: yes.
+(irqsoff) end
+EOF
+pass;
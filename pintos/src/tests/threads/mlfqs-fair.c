@@ -13,7 +13,15 @@
    They should receive 672, 588, 492, 408, 316, 232, 152, 92, 40,
    and 8 ticks, respectively, over 30 seconds.
 
-   (The above are computed via simulation in mlfqs.pm.) */
+   (The above are computed via simulation in mlfqs.pm.)
+
+   The cfs-* tests run the same workloads under the completely
+   fair scheduler, where each thread should receive a share of
+   the 3000 ticks proportional to its weight: 2,260 and 740
+   ticks for cfs-nice-2, and 671, 537, 429, 345, 277, 219, 178,
+   141, 113, and 90 ticks for cfs-nice-10.  (Computed in
+   cfs.pm.)  Both kinds of test also print the total number of
+   ticks the load threads received, for comparing throughput. */
 
 #include <stdio.h>
 #include <inttypes.h>
@@ -50,6 +58,30 @@ test_mlfqs_nice_10 (void)
 {
   test_mlfqs_fair (10, 0, 1);
 }
+
+void
+test_cfs_fair_2 (void) 
+{
+  test_mlfqs_fair (2, 0, 0);
+}
+
+void
+test_cfs_fair_20 (void) 
+{
+  test_mlfqs_fair (20, 0, 0);
+}
+
+void
+test_cfs_nice_2 (void) 
+{
+  test_mlfqs_fair (2, 0, 5);
+}
+
+void
+test_cfs_nice_10 (void) 
+{
+  test_mlfqs_fair (10, 0, 1);
+}
 
 #define MAX_THREAD_CNT 20
 
@@ -67,10 +99,11 @@ test_mlfqs_fair (int thread_cnt, int nice_min, int nice_step)
 {
   struct thread_info info[MAX_THREAD_CNT];
   int64_t start_time;
+  int total;
   int nice;
   int i;
 
-  ASSERT (thread_mlfqs);
+  ASSERT (thread_mlfqs || thread_cfs);
   ASSERT (thread_cnt <= MAX_THREAD_CNT);
   ASSERT (nice_min >= -10);
   ASSERT (nice_step >= 0);
@@ -100,8 +133,13 @@ test_mlfqs_fair (int thread_cnt, int nice_min, int nice_step)
   msg ("Sleeping 40 seconds to let threads run, please wait...");
   timer_sleep (40 * TIMER_FREQ);
   
+  total = 0;
   for (i = 0; i < thread_cnt; i++)
-    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+    {
+      msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+      total += info[i].tick_count;
+    }
+  msg ("Threads received %d ticks in total.", total);
 }
 
 static void
@@ -0,0 +1,58 @@
+/* Checks the buddy page allocator.
+
+   Allocates runs of pages whose lengths are not powers of 2 and
+   checks that they do not overlap.  Then allocates many single
+   pages, frees every other one and then the rest, and checks
+   that the freed pages were merged back together by allocating
+   a large block. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 8               /* Runs of pages to allocate. */
+#define PAGE_CNT 128            /* Single pages to allocate. */
+#define BIG_CNT 64              /* Pages in large block. */
+
+void
+test_palloc_buddy (void) 
+{
+  static void *pages[PAGE_CNT];
+  uint8_t *runs[RUN_CNT];
+  bool overlap = false;
+  void *big;
+  int i, j;
+
+  /* Runs of 1, 3, 5, ... pages, each filled with its index. */
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      runs[i] = palloc_get_multiple (0, 2 * i + 1);
+      if (runs[i] == NULL)
+        fail ("palloc_get_multiple (%d) failed", 2 * i + 1);
+      memset (runs[i], i, PGSIZE * (2 * i + 1));
+    }
+  for (i = 0; i < RUN_CNT; i++)
+    for (j = 0; j < PGSIZE * (2 * i + 1); j++)
+      if (runs[i][j] != i)
+        overlap = true;
+  msg ("Runs of pages are disjoint: %s.", overlap ? "no" : "yes");
+  for (i = 0; i < RUN_CNT; i++)
+    palloc_free_multiple (runs[i], 2 * i + 1);
+
+  /* Fragment the pool, then free everything. */
+  for (i = 0; i < PAGE_CNT; i++)
+    if ((pages[i] = palloc_get_page (0)) == NULL)
+      fail ("palloc_get_page failed");
+  for (i = 0; i < PAGE_CNT; i += 2)
+    palloc_free_page (pages[i]);
+  for (i = 1; i < PAGE_CNT; i += 2)
+    palloc_free_page (pages[i]);
+
+  big = palloc_get_multiple (0, BIG_CNT);
+  msg ("%d contiguous pages available after freeing: %s.",
+       BIG_CNT, big != NULL ? "yes" : "no");
+  palloc_free_multiple (big, BIG_CNT);
+}
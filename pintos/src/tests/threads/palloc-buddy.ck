@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Runs of pages are disjoint: yes.
+(palloc-buddy) 64 contiguous pages available after freeing: yes.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Sleeps so that the idle thread can fill the pools of
+   pre-zeroed pages, then checks that PAL_ZERO pages, whether
+   pre-zeroed or not, are entirely zero.  The pages are dirtied
+   before they are freed, so that any page that was not zeroed
+   again is caught the second time around. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 32             /* Pages to allocate at once. */
+
+void
+test_palloc_zero (void) 
+{
+  static uint8_t *pages[PAGE_CNT];
+  int round, i, j;
+
+  for (round = 0; round < 2; round++)
+    {
+      bool zero = true;
+
+      timer_sleep (10);
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          pages[i] = palloc_get_page (PAL_ZERO | (i % 2 ? PAL_USER : 0));
+          if (pages[i] == NULL)
+            fail ("palloc_get_page failed");
+          for (j = 0; j < PGSIZE; j++)
+            if (pages[i][j] != 0)
+              zero = false;
+        }
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          memset (pages[i], 0x5a, PGSIZE);
+          palloc_free_page (pages[i]);
+        }
+      msg ("Round %d: PAL_ZERO pages are zero: %s.",
+           round + 1, zero ? "yes" : "no");
+    }
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) Round 1: PAL_ZERO pages are zero: yes.
+(palloc-zero) Round 2: PAL_ZERO pages are zero: yes.
+(palloc-zero) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Busy-waits for 50 timer ticks under -profile=2 and checks that
+   the sampling profiler took a sample on about every other
+   tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/profile.h"
+#include "devices/timer.h"
+
+void
+test_profile (void)
+{
+  uint32_t start_cnt, sample_cnt;
+  int64_t start;
+
+  ASSERT (profile_enabled);
+  ASSERT (profile_interval == 2);
+
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start_cnt = profile_sample_cnt ();
+  start = timer_ticks ();
+  while (timer_ticks () - start < 50)
+    continue;
+  sample_cnt = profile_sample_cnt () - start_cnt;
+
+  msg ("Took 24 to 26 samples in 50 ticks: %s.",
+       sample_cnt >= 24 && sample_cnt <= 26 ? "yes" : "no");
+}
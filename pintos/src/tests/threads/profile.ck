@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(profile) begin
+(profile) Took 24 to 26 samples in 50 ticks: yes.
+(profile) end
+EOF
+pass;
@@ -0,0 +1,138 @@
+/* Runs READER_CNT threads that each perform LOOKUP_CNT lookups
+   in a shared table, first under a lock and then under an
+   rwlock, and reports how many ticks each took.  Each lookup
+   holds the lock across a one-tick sleep that stands in for
+   reading a directory sector from disk, so under a lock the
+   readers serialize while under an rwlock they overlap.
+
+   During the rwlock run a writer also rewrites the table, with a
+   sleep halfway through; the readers check that they never see
+   a partly rewritten table. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READER_CNT 16           /* Number of reader threads. */
+#define LOOKUP_CNT 5            /* Lookups per reader. */
+#define WRITE_CNT 2             /* Rewrites by the writer. */
+#define ENTRY_CNT 32            /* Entries in the table. */
+
+/* The "directory": every entry holds the same generation number
+   except while the writer is rewriting it. */
+static int table[ENTRY_CNT];
+
+static struct lock lock;
+static struct rwlock rwlock;
+static bool use_rwlock;
+
+/* Upped by each thread when it finishes. */
+static struct semaphore done;
+
+static thread_func reader;
+static thread_func writer;
+static int64_t run (bool use_rwlock_, bool with_writer);
+
+void
+test_rwlock_readers (void) 
+{
+  int64_t lock_ticks, rwlock_ticks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  lock_ticks = run (false, false);
+  msg ("lock: %d readers x %d lookups in %"PRId64" ticks",
+       READER_CNT, LOOKUP_CNT, lock_ticks);
+
+  rwlock_ticks = run (true, true);
+  msg ("rwlock: %d readers x %d lookups in %"PRId64" ticks",
+       READER_CNT, LOOKUP_CNT, rwlock_ticks);
+
+  if (rwlock_ticks >= lock_ticks)
+    fail ("readers did not overlap under the rwlock");
+  msg ("readers overlapped under the rwlock.");
+}
+
+/* Starts the readers, and the writer if WITH_WRITER, using the
+   rwlock if USE_RWLOCK_ or the lock otherwise, and returns the
+   number of ticks until they all finish. */
+static int64_t
+run (bool use_rwlock_, bool with_writer) 
+{
+  int64_t start;
+  int thread_cnt = READER_CNT + (with_writer ? 1 : 0);
+  int i;
+
+  use_rwlock = use_rwlock_;
+  start = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader, NULL);
+    }
+  if (with_writer)
+    thread_create ("writer", PRI_DEFAULT, writer, NULL);
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+  return timer_ticks () - start;
+}
+
+/* Looks up every entry of the table LOOKUP_CNT times, sleeping
+   for a tick in the middle of each lookup. */
+static void
+reader (void *aux UNUSED) 
+{
+  int i, j;
+
+  for (i = 0; i < LOOKUP_CNT; i++) 
+    {
+      if (use_rwlock)
+        rwlock_acquire_read (&rwlock);
+      else
+        lock_acquire (&lock);
+
+      timer_sleep (1);
+      for (j = 1; j < ENTRY_CNT; j++)
+        if (table[j] != table[0])
+          fail ("%s saw a partly rewritten table", thread_name ());
+
+      if (use_rwlock)
+        rwlock_release_read (&rwlock);
+      else
+        lock_release (&lock);
+    }
+  sema_up (&done);
+}
+
+/* Rewrites the table WRITE_CNT times under the rwlock, sleeping
+   halfway through each rewrite. */
+static void
+writer (void *aux UNUSED) 
+{
+  int i, j;
+
+  for (i = 0; i < WRITE_CNT; i++) 
+    {
+      rwlock_acquire_write (&rwlock);
+      for (j = 0; j < ENTRY_CNT; j++) 
+        {
+          if (j == ENTRY_CNT / 2)
+            timer_sleep (1);
+          table[j]++;
+        }
+      rwlock_release_write (&rwlock);
+      timer_sleep (1);
+    }
+  sema_up (&done);
+}
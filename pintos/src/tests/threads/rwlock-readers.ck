@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $kind ('lock', 'rwlock') {
+    fail "Missing timing for $kind.\n"
+      if !grep (/\) $kind: \d+ readers x \d+ lookups in \d+ ticks$/, @output);
+}
+fail "Readers did not overlap.\n"
+  if !grep (/readers overlapped under the rwlock\./, @output);
+pass;
@@ -0,0 +1,89 @@
+/* Measures the cost of a context switch between two threads of
+   equal priority while 10, 100, and 1000 lower-priority threads
+   sit in the run queue.  With a constant-time run queue the
+   per-switch cost should not grow with the number of ready
+   threads. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+
+#define SWITCH_CNT 10000
+
+static thread_func filler_thread;
+static thread_func yield_thread;
+
+static void measure (int ready_cnt);
+
+void
+test_sched_switch (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  measure (10);
+  measure (100);
+  measure (1000);
+}
+
+/* Fills the run queue with READY_CNT threads below our priority,
+   then ping-pongs with a thread at our own priority and reports
+   the average number of cycles per switch. */
+static void
+measure (int ready_cnt) 
+{
+  struct semaphore done;
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&done, 0);
+  for (i = 0; i < ready_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "f%d", i);
+      if (thread_create (name, PRI_DEFAULT - 1, filler_thread, &done)
+          == TID_ERROR)
+        fail ("could not create %d ready threads", ready_cnt);
+    }
+  thread_create ("yielder", PRI_DEFAULT, yield_thread, NULL);
+
+  /* Each of our yields switches to the yielder and each of its
+     yields switches back, so there are two switches per
+     iteration. */
+  start = rdtsc ();
+  for (i = 0; i < SWITCH_CNT / 2; i++)
+    thread_yield ();
+  cycles = rdtsc () - start;
+
+  msg ("%d ready threads: %"PRIu64" cycles per switch",
+       ready_cnt, cycles / SWITCH_CNT);
+
+  /* Let the fillers run and exit. */
+  for (i = 0; i < ready_cnt; i++)
+    sema_down (&done);
+}
+
+/* Exits as soon as it gets to run. */
+static void
+filler_thread (void *done_) 
+{
+  struct semaphore *done = done_;
+  sema_up (done);
+}
+
+/* Yields back to the main thread SWITCH_CNT / 2 times. */
+static void
+yield_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < SWITCH_CNT / 2; i++)
+    thread_yield ();
+}
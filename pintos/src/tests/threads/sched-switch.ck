@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $cnt (10, 100, 1000) {
+    fail "Missing switch cost with $cnt ready threads.\n"
+      if !grep (/\b$cnt ready threads: \d+ cycles per switch/, @output);
+}
+pass;
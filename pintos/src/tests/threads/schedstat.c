@@ -0,0 +1,84 @@
+/* Checks the per-thread scheduler statistics kept with
+   -schedstat.  A child thread yields YIELD_CNT times and sleeps
+   SLEEP_CNT times, then spins through PREEMPT_TICKS timer ticks
+   so that it is preempted by its sibling at the same priority,
+   and reports which of its counters are consistent with that. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define YIELD_CNT 10
+#define SLEEP_CNT 5
+#define PREEMPT_TICKS 20
+
+static struct semaphore done;
+static struct schedstat child_stats;
+
+static thread_func child;
+static thread_func spinner;
+
+void
+test_schedstat (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (schedstat_enabled);
+
+  sema_init (&done, 0);
+  thread_create ("child", PRI_DEFAULT - 1, child, NULL);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+  sema_down (&done);
+  sema_down (&done);
+
+  msg ("Child was switched to at least %d times: %s.",
+       YIELD_CNT + SLEEP_CNT,
+       child_stats.dispatches >= YIELD_CNT + SLEEP_CNT ? "yes" : "no");
+  msg ("Child gave up the CPU voluntarily at least %d times: %s.",
+       YIELD_CNT + SLEEP_CNT,
+       child_stats.voluntary >= YIELD_CNT + SLEEP_CNT ? "yes" : "no");
+  msg ("Child was preempted: %s.",
+       child_stats.involuntary > 0 ? "yes" : "no");
+  msg ("Child ran and waited: %s.",
+       child_stats.run_cycles > 0 && child_stats.ready_cycles > 0
+       ? "yes" : "no");
+}
+
+/* Yields, sleeps, and spins, then saves its statistics. */
+static void
+child (void *aux UNUSED) 
+{
+  enum intr_level old_level;
+  int64_t end;
+  int i;
+
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    timer_sleep (1);
+
+  end = timer_ticks () + PREEMPT_TICKS;
+  while (timer_ticks () < end)
+    continue;
+
+  old_level = intr_disable ();
+  child_stats = thread_current ()->sched;
+  intr_set_level (old_level);
+  sema_up (&done);
+}
+
+/* Spins alongside the child so that the scheduler has someone
+   to preempt it for. */
+static void
+spinner (void *aux UNUSED) 
+{
+  int64_t end = timer_ticks () + PREEMPT_TICKS * 2;
+
+  while (timer_ticks () < end)
+    continue;
+  sema_up (&done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(schedstat) begin
+(schedstat) Child was switched to at least 15 times: yes.
+(schedstat) Child gave up the CPU voluntarily at least 15 times: yes.
+(schedstat) Child was preempted: yes.
+(schedstat) Child ran and waited: yes.
+(schedstat) end
+EOF
+pass;
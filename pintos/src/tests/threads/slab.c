@@ -0,0 +1,119 @@
+/* Checks a kmem_cache of 600-byte objects, a size that malloc()
+   rounds up to 1,024 bytes.
+
+   Objects must be constructed only once, when their slab is
+   created, and come back from the cache still constructed.
+   Successive slabs must be colored differently, and the cache
+   must need fewer pages than malloc() for the same objects.
+
+   Finally, reports how many objects per second can be allocated
+   and freed with malloc() and with the cache. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define OBJ_CNT 60              /* Objects to allocate at once. */
+#define WINDOW 20               /* Ticks to measure each rate for. */
+#define OBJ_MAGIC 0x0b1ec75     /* Marks a constructed object. */
+
+struct object
+  {
+    unsigned magic;             /* OBJ_MAGIC once constructed. */
+    char data[596];             /* Scribbled on by the test. */
+  };
+
+static struct kmem_cache object_cache;
+static size_t ctor_cnt;
+
+static kmem_ctor_func object_ctor;
+static void measure (bool slab);
+
+void
+test_slab (void) 
+{
+  struct object *objs[OBJ_CNT];
+  bool constructed = true;
+  bool colored = false;
+  int i;
+
+  kmem_cache_init (&object_cache, "object", sizeof (struct object), 0,
+                   object_ctor);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (&object_cache);
+      if (objs[i] == NULL)
+        fail ("kmem_cache_alloc returned null");
+      constructed = constructed && objs[i]->magic == OBJ_MAGIC;
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+  for (i = 1; i < OBJ_CNT; i++)
+    if (pg_round_down (objs[i]) != pg_round_down (objs[0])
+        && pg_ofs (objs[i]) % sizeof (struct object)
+           != pg_ofs (objs[0]) % sizeof (struct object))
+      colored = true;
+  msg ("Objects constructed: %s.", constructed ? "yes" : "no");
+  msg ("Slabs colored differently: %s.", colored ? "yes" : "no");
+  msg ("Fewer pages than malloc: %s.",
+       object_cache.slab_cnt < malloc_page_cnt (sizeof (struct object),
+                                                OBJ_CNT) ? "yes" : "no");
+
+  /* A freed object keeps its constructed state, so reallocating
+     it must not construct it again. */
+  ctor_cnt = 0;
+  kmem_cache_free (&object_cache, objs[0]);
+  objs[0] = kmem_cache_alloc (&object_cache);
+  msg ("Objects still constructed after reuse: %s.",
+       objs[0]->magic == OBJ_MAGIC && ctor_cnt == 0 ? "yes" : "no");
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&object_cache, objs[i]);
+
+  measure (false);
+  measure (true);
+}
+
+/* Allocates and frees an object over and over for WINDOW ticks,
+   with the cache if SLAB is true or with malloc() otherwise, and
+   reports the rate. */
+static void
+measure (bool slab) 
+{
+  const char *what = slab ? "kmem_cache" : "malloc";
+  int64_t end;
+  long long cnt = 0;
+
+  /* Start at a tick boundary. */
+  timer_sleep (1);
+  end = timer_ticks () + WINDOW;
+  while (timer_ticks () < end) 
+    {
+      void *p = (slab ? kmem_cache_alloc (&object_cache)
+                 : malloc (sizeof (struct object)));
+      if (p == NULL)
+        fail ("%s returned null", what);
+      if (slab)
+        kmem_cache_free (&object_cache, p);
+      else
+        free (p);
+      cnt++;
+    }
+
+  msg ("%s: %lld allocations per second", what, cnt * TIMER_FREQ / WINDOW);
+}
+
+/* Constructs an object. */
+static void
+object_ctor (void *obj_) 
+{
+  struct object *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  ctor_cnt++;
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $check ('Objects constructed',
+		   'Slabs colored differently',
+		   'Fewer pages than malloc',
+		   'Objects still constructed after reuse') {
+    fail "$check: missing or \"no\".\n"
+      if !grep (/\(slab\) $check: yes\./, @output);
+}
+foreach my $what ('malloc', 'kmem_cache') {
+    fail "Missing allocation rate for $what.\n"
+      if !grep (/\(slab\) $what: \d+ allocations per second/, @output);
+}
+pass;
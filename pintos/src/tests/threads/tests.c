@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -38,6 +39,24 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"edf", test_edf},
+    {"irqsoff", test_irqsoff},
+    {"hires-sleep", test_hires_sleep},
+    {"profile", test_profile},
+    {"slab", test_slab},
+    {"palloc-buddy", test_palloc_buddy},
+    {"palloc-zero", test_palloc_zero},
+    {"bitmap-scan", test_bitmap_scan},
+    {"hash-rehash", test_hash_rehash},
+    {"sched-switch", test_sched_switch},
+    {"rwlock-readers", test_rwlock_readers},
+    {"workqueue", test_workqueue},
+    {"thread-spawn", test_thread_spawn},
+    {"schedstat", test_schedstat},
   };
 
 static const char *test_name;
@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -32,6 +33,24 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_edf;
+extern test_func test_irqsoff;
+extern test_func test_hires_sleep;
+extern test_func test_profile;
+extern test_func test_slab;
+extern test_func test_palloc_buddy;
+extern test_func test_palloc_zero;
+extern test_func test_bitmap_scan;
+extern test_func test_hash_rehash;
+extern test_func test_sched_switch;
+extern test_func test_rwlock_readers;
+extern test_func test_workqueue;
+extern test_func test_thread_spawn;
+extern test_func test_schedstat;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,65 @@
+/* Creates short-lived threads back to back for WINDOW ticks,
+   first with the thread page cache turned off and then with it
+   on, and reports how many threads per second were created and
+   how many cycles each creation took.  Each thread has higher
+   priority than us, so it runs and exits as soon as it is
+   created and its page is free again before the next
+   thread_create(). */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+#include "devices/timer.h"
+
+#define WINDOW 50               /* Ticks to spawn threads for. */
+
+static thread_func exit_thread;
+static void measure (bool cache);
+
+void
+test_thread_spawn (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  measure (false);
+  measure (true);
+  thread_page_cache_enabled = true;
+}
+
+/* Spawns threads for WINDOW ticks with the page cache turned on
+   if CACHE is true, and reports the rate. */
+static void
+measure (bool cache) 
+{
+  const char *what = cache ? "with page cache" : "without page cache";
+  int64_t end;
+  uint64_t start;
+  long long cnt = 0;
+
+  thread_page_cache_enabled = cache;
+
+  /* Start at a tick boundary. */
+  timer_sleep (1);
+  end = timer_ticks () + WINDOW;
+  start = rdtsc ();
+  while (timer_ticks () < end) 
+    {
+      if (thread_create ("spawned", PRI_DEFAULT + 1, exit_thread, NULL)
+          == TID_ERROR)
+        fail ("thread_create failed %s", what);
+      cnt++;
+    }
+
+  msg ("%s: %lld threads per second, %"PRIu64" cycles per thread",
+       what, cnt * TIMER_FREQ / WINDOW, (rdtsc () - start) / cnt);
+}
+
+/* Exits as soon as it gets to run. */
+static void
+exit_thread (void *aux UNUSED) 
+{
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $what ('without page cache', 'with page cache') {
+    fail "Missing spawn rate $what.\n"
+      if !grep (/$what: \d+ threads per second, \d+ cycles per thread/,
+		@output);
+}
+pass;
@@ -0,0 +1,98 @@
+/* Checks that a workqueue runs queued items in priority order,
+   FIFO among equals; merges a request for an item that is
+   already queued; refuses items beyond its depth; runs delayed
+   items no earlier than requested; and can cancel a delayed
+   item. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* A work item that reports when it runs. */
+struct test_item 
+  {
+    struct work work;
+    const char *name;
+    int64_t ran_at;             /* Tick at which it ran. */
+  };
+
+static struct workqueue wq;
+static struct semaphore done;
+
+/* Work function for a test_item: reports that it ran. */
+static void
+run_item (struct work *w) 
+{
+  struct test_item *item = (struct test_item *) w;
+
+  item->ran_at = timer_ticks ();
+  msg ("Ran %s at priority %d.", item->name, thread_get_priority ());
+  sema_up (&done);
+}
+
+/* Initializes ITEM, named NAME, to run at PRIORITY. */
+static void
+test_item_init (struct test_item *item, const char *name, int priority) 
+{
+  work_init (&item->work, run_item, priority);
+  item->name = name;
+}
+
+void
+test_workqueue (void) 
+{
+  struct test_item a, b, c, d, e, delayed, cancelled;
+  struct workqueue_stats stats;
+  int64_t start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+
+  /* The worker has lower priority than us, so nothing runs until
+     we block. */
+  if (!workqueue_create (&wq, "test", 1, PRI_DEFAULT - 10, 4))
+    fail ("could not create workqueue");
+
+  test_item_init (&a, "a", PRI_DEFAULT - 7);
+  test_item_init (&b, "b", PRI_DEFAULT - 2);
+  test_item_init (&c, "c", PRI_DEFAULT - 5);
+  test_item_init (&d, "d", PRI_DEFAULT - 2);
+  test_item_init (&e, "e", PRI_DEFAULT - 1);
+
+  workqueue_queue (&wq, &a.work);
+  workqueue_queue (&wq, &b.work);
+  workqueue_queue (&wq, &c.work);
+  workqueue_queue (&wq, &d.work);
+  if (!workqueue_queue (&wq, &a.work))
+    fail ("queuing a queued item again failed");
+  if (workqueue_queue (&wq, &e.work))
+    fail ("queuing beyond the workqueue's depth succeeded");
+  for (i = 0; i < 4; i++)
+    sema_down (&done);
+
+  workqueue_get_stats (&wq, &stats);
+  msg ("%llu queued, %llu merged, %llu rejected.",
+       stats.queued, stats.merged, stats.rejected);
+
+  test_item_init (&delayed, "delayed", PRI_DEFAULT - 1);
+  start = timer_ticks ();
+  workqueue_queue_delayed (&wq, &delayed.work, 5);
+  sema_down (&done);
+  if (delayed.ran_at - start < 5)
+    fail ("delayed item ran after %lld ticks", delayed.ran_at - start);
+  msg ("Delayed item waited at least 5 ticks.");
+
+  test_item_init (&cancelled, "cancelled", PRI_DEFAULT - 1);
+  workqueue_queue_delayed (&wq, &cancelled.work, 1000);
+  msg ("First cancel %s.",
+       workqueue_cancel (&cancelled.work) ? "succeeded" : "failed");
+  msg ("Second cancel %s.",
+       workqueue_cancel (&cancelled.work) ? "succeeded" : "failed");
+}
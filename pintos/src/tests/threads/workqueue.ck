@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Ran b at priority 29.
+(workqueue) Ran d at priority 29.
+(workqueue) Ran c at priority 26.
+(workqueue) Ran a at priority 24.
+(workqueue) 4 queued, 1 merged, 1 rejected.
+(workqueue) Ran delayed at priority 30.
+(workqueue) Delayed item waited at least 5 ticks.
+(workqueue) First cancel succeeded.
+(workqueue) Second cancel failed.
+(workqueue) end
+EOF
+pass;
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "devices/apic.h"
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
@@ -20,8 +21,11 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -119,6 +123,8 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  apic_init ();
+  workqueue_init ();
 
 #ifdef FILESYS
   /* Initialize file system. */
@@ -256,6 +262,30 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-apic"))
+        apic_requested = true;
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+      else if (!strcmp (name, "-schedstat"))
+        schedstat_enabled = true;
+      else if (!strcmp (name, "-irqsoff"))
+        intr_trace_irqsoff = true;
+      else if (!strcmp (name, "-profile"))
+        {
+          profile_enabled = true;
+          if (value != NULL && atoi (value) > 0)
+            profile_interval = atoi (value);
+        }
+      else if (!strcmp (name, "-wq"))
+        {
+          if (value == NULL || atoi (value) < 1)
+            PANIC ("-wq requires a thread count of at least 1");
+          workqueue_system_threads = atoi (value);
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -263,6 +293,8 @@ parse_options (char **argv)
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
+  if (thread_mlfqs && thread_cfs)
+    PANIC ("-mlfqs and -cfs are mutually exclusive");
 
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -379,6 +411,14 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -cfs               Use completely fair scheduler.\n"
+          "  -tickless          Stop the periodic timer tick when idle.\n"
+          "  -apic              Use the local and I/O APICs if present.\n"
+          "  -lockstat          Print lock contention statistics at shutdown.\n"
+          "  -schedstat         Print per-thread scheduler statistics at shutdown.\n"
+          "  -irqsoff           Print longest interrupts-off sections at shutdown.\n"
+          "  -profile[=N]       Sample EIP every N ticks (default 1), print at shutdown.\n"
+          "  -wq=N              Run the system workqueue on N threads (default 1).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
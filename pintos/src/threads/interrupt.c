@@ -7,7 +7,9 @@
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
+#include "devices/apic.h"
 #include "devices/timer.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
@@ -47,6 +49,40 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Interrupts-off latency tracer.  Each stretch of time that
+   interrupts are off is timed with the TSC, from where they were
+   turned off, by intr_disable() or by entering an interrupt
+   handler, to where intr_enable() or intr_set_level() turned them
+   back on, or the handler returned.  The longest and total times
+   are kept for each pair of those places, identified by return
+   address so that utils/backtrace can name them.  A section ended
+   by the CPU itself, as by "sti; hlt" in the idle thread, cannot
+   be timed and is discarded.  Enabled by "-irqsoff". */
+bool intr_trace_irqsoff;
+#define IRQSOFF_SITES 64        /* Distinct sections tracked. */
+#define IRQSOFF_PRINT 10        /* Sections printed at shutdown. */
+struct irqsoff_site
+  {
+    void *off_at;               /* Where interrupts were turned off. */
+    void *on_at;                /* Where they were turned back on. */
+    uint64_t max;               /* Longest time off, in cycles. */
+    uint64_t total;             /* Sum of times off, in cycles. */
+    unsigned count;             /* Number of sections. */
+  };
+static struct irqsoff_site irqsoff_sites[IRQSOFF_SITES];
+static unsigned irqsoff_dropped; /* Sections with no room in table. */
+static uint64_t irqsoff_start;  /* TSC when turned off, 0 if not timing. */
+static void *irqsoff_at;        /* Where interrupts were turned off. */
+
+static enum intr_level enable (void *caller);
+static enum intr_level disable (void *caller);
+static void irqsoff_begin (void *off_at);
+static void irqsoff_end (void *on_at);
+
+/* True if external interrupts come through the APICs rather
+   than the PICs. */
+static bool use_apic;
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -80,16 +116,35 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  void *caller = __builtin_return_address (0);
+  return level == INTR_ON ? enable (caller) : disable (caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) 
+{
+  return enable (__builtin_return_address (0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable (void) 
+{
+  return disable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the function that will return
+   to CALLER and returns the previous interrupt status. */
+static inline enum intr_level
+enable (void *caller) 
 {
   enum intr_level old_level = intr_get_level ();
   ASSERT (!intr_context ());
 
+  if (intr_trace_irqsoff && old_level == INTR_OFF)
+    irqsoff_end (caller);
+
   /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -99,9 +154,10 @@ intr_enable (void)
   return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable (void) 
+/* Disables interrupts on behalf of the function that will return
+   to CALLER and returns the previous interrupt status. */
+static inline enum intr_level
+disable (void *caller) 
 {
   enum intr_level old_level = intr_get_level ();
 
@@ -110,6 +166,9 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (intr_trace_irqsoff && old_level == INTR_ON)
+    irqsoff_begin (caller);
+
   return old_level;
 }
 
@@ -258,6 +317,19 @@ pic_init (void)
   outb (PIC1_DATA, 0x00);
 }
 
+/* Masks every interrupt line on the PICs and acknowledges
+   external interrupts through the local APIC from now on.
+   Called by apic_init() with interrupts off. */
+void
+intr_use_apic (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  outb (PIC0_DATA, 0xff);
+  outb (PIC1_DATA, 0xff);
+  use_apic = true;
+}
+
 /* Sends an end-of-interrupt signal to the PIC for the given IRQ.
    If we don't acknowledge the IRQ, it will never be delivered to
    us again, so this is important.  */
@@ -347,6 +419,13 @@ intr_handler (struct intr_frame *frame)
   bool external;
   intr_handler_func *handler;
 
+  /* Interrupts are off if this is an external interrupt or an
+     internal interrupt registered with INTR_OFF.  Either way they
+     were on before, so any section being timed was ended by the
+     CPU, and a new one starts here. */
+  if (intr_trace_irqsoff && intr_get_level () == INTR_OFF)
+    irqsoff_begin ((void *) intr_handlers[frame->vec_no]);
+
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
      and they need to be acknowledged on the PIC (see below).
@@ -359,6 +438,10 @@ intr_handler (struct intr_frame *frame)
 
       in_external_intr = true;
       yield_on_return = false;
+
+      /* Bring the clock up to date if the CPU was idling
+         without a periodic tick. */
+      timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
@@ -381,11 +464,123 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_context ());
 
       in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      if (use_apic)
+        apic_eoi ();
+      else
+        pic_end_of_interrupt (frame->vec_no); 
+
+      /* Returning turns interrupts back on, unless we first
+         switch to another thread, which will turn them on
+         itself. */
+      if (intr_trace_irqsoff)
+        {
+          irqsoff_end (frame->eip);
+          if (yield_on_return)
+            irqsoff_begin ((void *) thread_preempt);
+        }
 
       if (yield_on_return) 
-        thread_yield (); 
+        thread_preempt (); 
+    }
+}
+
+/* Starts timing a section with interrupts off, which were turned
+   off at OFF_AT. */
+static void
+irqsoff_begin (void *off_at) 
+{
+  irqsoff_start = rdtsc ();
+  irqsoff_at = off_at;
+}
+
+/* Ends the section being timed, if any, with interrupts about to
+   be turned back on at ON_AT, and records its length. */
+static void
+irqsoff_end (void *on_at) 
+{
+  struct irqsoff_site *s = NULL;
+  uint64_t cycles;
+  unsigned h, i;
+
+  if (irqsoff_start == 0)
+    return;
+  cycles = rdtsc () - irqsoff_start;
+  irqsoff_start = 0;
+
+  /* Find the site in irqsoff_sites by linear probing. */
+  h = ((uintptr_t) irqsoff_at ^ ((uintptr_t) on_at << 7)) * 2654435761u;
+  for (i = 0; i < IRQSOFF_SITES; i++)
+    {
+      s = &irqsoff_sites[(h + i) % IRQSOFF_SITES];
+      if (s->count == 0)
+        {
+          s->off_at = irqsoff_at;
+          s->on_at = on_at;
+          break;
+        }
+      if (s->off_at == irqsoff_at && s->on_at == on_at)
+        break;
+    }
+  if (i == IRQSOFF_SITES)
+    {
+      irqsoff_dropped++;
+      return;
+    }
+
+  s->count++;
+  s->total += cycles;
+  if (cycles > s->max)
+    s->max = cycles;
+}
+
+/* Returns the longest time, in cycles, that interrupts have been
+   off since -irqsoff tracing started, or 0 if it is disabled. */
+uint64_t
+intr_irqsoff_max (void) 
+{
+  uint64_t max = 0;
+  int i;
+
+  for (i = 0; i < IRQSOFF_SITES; i++)
+    if (irqsoff_sites[i].max > max)
+      max = irqsoff_sites[i].max;
+  return max;
+}
+
+/* Prints the sections during which interrupts were off longest,
+   longest first.  The addresses can be passed to utils/backtrace
+   to find the functions that turned interrupts off and back on.
+   Does nothing unless -irqsoff was given.  Stops tracing. */
+void
+intr_print_stats (void) 
+{
+  int i, j;
+
+  if (!intr_trace_irqsoff)
+    return;
+  intr_trace_irqsoff = false;
+
+  /* Sort by longest section.  The table is no longer needed for
+     lookups, so it can be sorted in place. */
+  for (i = 1; i < IRQSOFF_SITES; i++)
+    {
+      struct irqsoff_site s = irqsoff_sites[i];
+      for (j = i; j > 0 && irqsoff_sites[j - 1].max < s.max; j--)
+        irqsoff_sites[j] = irqsoff_sites[j - 1];
+      irqsoff_sites[j] = s;
+    }
+
+  printf ("Interrupts-off sections (times in cycles):\n");
+  printf ("%12s %12s %10s  %-10s %-10s\n",
+          "max", "avg", "count", "off at", "on at");
+  for (i = 0; i < IRQSOFF_PRINT && irqsoff_sites[i].count > 0; i++)
+    {
+      const struct irqsoff_site *s = &irqsoff_sites[i];
+      printf ("%12llu %12llu %10u  %-10p %-10p\n", s->max,
+              s->total / s->count, s->count, s->off_at, s->on_at);
     }
+  if (irqsoff_dropped > 0)
+    printf ("%u sections not recorded: table full.\n", irqsoff_dropped);
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -58,6 +58,7 @@ struct intr_frame
 typedef void intr_handler_func (struct intr_frame *);
 
 void intr_init (void);
+void intr_use_apic (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
@@ -67,4 +68,9 @@ void intr_yield_on_return (void);
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
+/* Interrupts-off latency tracing. */
+extern bool intr_trace_irqsoff;
+uint64_t intr_irqsoff_max (void);
+void intr_print_stats (void);
+
 #endif /* threads/interrupt.h */
@@ -41,6 +41,7 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    char name[16];              /* Lock name, e.g. "malloc32". */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -80,7 +81,8 @@ malloc_init (void)
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
-      lock_init (&d->lock);
+      snprintf (d->name, sizeof d->name, "malloc%zu", block_size);
+      lock_init_named (&d->lock, d->name);
     }
 }
 
@@ -263,6 +265,20 @@ free (void *p)
     }
 }
 
+/* Returns the number of pages that CNT blocks of SIZE bytes,
+   all allocated at once, would occupy if they were packed into
+   as few arenas as possible. */
+size_t
+malloc_page_cnt (size_t size, size_t cnt) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->block_size >= size)
+      return DIV_ROUND_UP (cnt, d->blocks_per_arena);
+  return cnt * DIV_ROUND_UP (size + sizeof (struct arena), PGSIZE);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
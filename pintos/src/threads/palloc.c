@@ -1,6 +1,6 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
+#include <list.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stddef.h>
@@ -8,7 +8,8 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +24,68 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a binary buddy system.  The pool's
+   free pages are kept in blocks of 2**ORDER pages, for ORDER
+   from 0 to MAX_ORDER, with the block's first page index a
+   multiple of its size.  Each order has its own free list, whose
+   list elements live in the free pages themselves.  A block of
+   order ORDER has a "buddy", the block of the same order that it
+   was split from, at the index that differs from its own only in
+   bit ORDER.
+
+   To allocate, we take a block from the smallest order that is
+   big enough and has a free block, splitting it in halves until
+   it is the size requested, and putting the unused halves on
+   their free lists.  To free, we merge the block with its buddy
+   as long as the buddy is a free block of the same order.  Both
+   take O(MAX_ORDER) time, independent of the pool size.
+
+   A request for a number of pages that is not a power of 2 is
+   rounded up to a block, and the pages past the end of the
+   request are freed right away, so no more than the pages asked
+   for remain in use.  Likewise, any run of pages may be freed:
+   it is freed as the largest aligned blocks that make it up.
+
+   Each pool also keeps a list of pages that are already zeroed,
+   which the idle thread fills from the free blocks when there is
+   nothing else to do.  A single-page PAL_ZERO allocation takes a
+   page from this list if it can, so it does not have to zero the
+   page itself.  If a pool runs out of free blocks, its zeroed
+   pages are given back to the buddy system.
+
+   The free lists are short critical sections, so they are
+   guarded by a spinlock with interrupts off rather than by a
+   lock.  That also lets the scheduler free a dying thread's page
+   with interrupts off. */
+
+/* Largest block order: 2**16 pages, or 256 MB. */
+#define MAX_ORDER 16
+
+/* Most pre-zeroed pages to keep in a pool.  No more than a
+   sixteenth of the pool is kept zeroed. */
+#define ZEROED_MAX 64
+
+/* Value in a pool's ORDERS array for a page that does not begin
+   a free block. */
+#define NOT_FREE 0xff
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct spinlock lock;               /* Mutual exclusion. */
+    const char *name;                   /* Name, for statistics. */
+    uint8_t *orders;                    /* Order of free block at each page. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+    struct list free[MAX_ORDER + 1];    /* Free blocks of each order. */
+    struct list zeroed;                 /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pre-zeroed pages. */
+    size_t zeroed_max;                  /* Most pre-zeroed pages to keep. */
+    unsigned long long zero_hits;       /* PAL_ZERO pages already zeroed. */
+    unsigned long long zero_misses;     /* PAL_ZERO pages zeroed on demand. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +94,16 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static struct list_elem *idx_to_elem (const struct pool *, size_t page_idx);
+static size_t elem_to_idx (const struct pool *, struct list_elem *);
+static size_t take_pages (struct pool *, enum palloc_flags,
+                          size_t page_cnt, bool *zeroed);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static size_t alloc_block (struct pool *, int order);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static bool zero_page (struct pool *);
+static void print_pool_stats (const struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -61,6 +126,17 @@ palloc_init (size_t user_page_limit)
              user_pages, "user pool");
 }
 
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+page_cnt_to_order (size_t page_cnt) 
+{
+  int order = 0;
+
+  while ((size_t) 1 << order < page_cnt)
+    order++;
+  return order;
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -73,22 +149,30 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  bool zeroed = false;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  page_idx = take_pages (pool, flags, page_cnt, &zeroed);
 
-  if (page_idx != BITMAP_ERROR)
+  /* Before failing, take back the pages that the thread system
+     keeps cached for new threads. */
+  if (page_idx == SIZE_MAX && pool == &kernel_pool
+      && thread_page_cache_drain () > 0)
+    page_idx = take_pages (pool, flags, page_cnt, &zeroed);
+
+  if (page_idx != SIZE_MAX)
     pages = pool->base + PGSIZE * page_idx;
   else
     pages = NULL;
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      /* A pre-zeroed page is zero except for its list element. */
+      if (zeroed)
+        memset (pages, 0, sizeof (struct list_elem));
+      else if (flags & PAL_ZERO)
         memset (pages, 0, PGSIZE * page_cnt);
     }
   else 
@@ -113,10 +197,12 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
+/* Frees the PAGE_CNT pages starting at PAGES.
+   May be called with interrupts off. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
+  enum intr_level old_level;
   struct pool *pool;
   size_t page_idx;
 
@@ -132,41 +218,80 @@ palloc_free_multiple (void *pages, size_t page_cnt)
     NOT_REACHED ();
 
   page_idx = pg_no (pages) - pg_no (pool->base);
+  ASSERT (page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = spinlock_acquire_irqsave (&pool->lock);
+  free_range (pool, page_idx, page_cnt);
+  spinlock_release_irqrestore (&pool->lock, old_level);
 }
 
-/* Frees the page at PAGE. */
+/* Frees the page at PAGE.
+   May be called with interrupts off. */
 void
 palloc_free_page (void *page) 
 {
   palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page and adds it to its pool's pre-zeroed pages,
+   if a pool wants more of them.  Returns true if a page was
+   zeroed, false if there was nothing to do.
+
+   Called by the idle thread.  The page is zeroed with interrupts
+   on, so an interrupt that makes a thread ready is handled, and
+   the idle thread preempted, without waiting for the page to be
+   finished. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_page (&kernel_pool) || zero_page (&user_pool);
+}
+
+/* Prints how each pool's free pages are divided into blocks. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  size_t map_pages;
+  int order;
+
+  /* We'll put the pool's order map at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  map_pages = DIV_ROUND_UP (page_cnt, PGSIZE);
+  if (map_pages > page_cnt)
+    PANIC ("Not enough memory in %s for order map.", name);
+  page_cnt -= map_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  spinlock_init (&p->lock);
+  p->name = name;
+  p->orders = base;
+  memset (p->orders, NOT_FREE, page_cnt);
+  p->base = base + map_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free[order]);
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / 16 < ZEROED_MAX ? page_cnt / 16 : ZEROED_MAX;
+  p->zero_hits = p->zero_misses = 0;
+  free_range (p, 0, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -176,7 +301,227 @@ page_from_pool (const struct pool *pool, void *page)
 {
   size_t page_no = pg_no (page);
   size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t end_page = start_page + pool->page_cnt;
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in the page at PAGE_IDX
+   in POOL. */
+static struct list_elem *
+idx_to_elem (const struct pool *pool, size_t page_idx) 
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index of the page that holds free list element E
+   in POOL. */
+static size_t
+elem_to_idx (const struct pool *pool, struct list_elem *e) 
+{
+  return pg_no (e) - pg_no (pool->base);
+}
+
+/* Takes PAGE_CNT pages from POOL for palloc_get_multiple() with
+   FLAGS: a pre-zeroed page if one is wanted and available, in
+   which case sets *ZEROED to true, or else fresh pages.  Returns
+   the index of the first page, or SIZE_MAX if POOL has too few
+   pages. */
+static size_t
+take_pages (struct pool *pool, enum palloc_flags flags, size_t page_cnt,
+            bool *zeroed) 
+{
+  enum intr_level old_level;
+  size_t page_idx;
+
+  old_level = spinlock_acquire_irqsave (&pool->lock);
+  if (page_cnt == 1 && (flags & PAL_ZERO) && !list_empty (&pool->zeroed))
+    {
+      page_idx = elem_to_idx (pool, list_pop_front (&pool->zeroed));
+      pool->zeroed_cnt--;
+      pool->zero_hits++;
+      *zeroed = true;
+    }
+  else 
+    {
+      page_idx = alloc_pages (pool, page_cnt);
+      if (page_idx != SIZE_MAX && (flags & PAL_ZERO))
+        pool->zero_misses++;
+    }
+  spinlock_release_irqrestore (&pool->lock, old_level);
+
+  return page_idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or SIZE_MAX if no block is big enough
+   even after giving POOL's pre-zeroed pages back.  POOL's lock
+   must be held. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt) 
+{
+  int order = page_cnt_to_order (page_cnt);
+  size_t page_idx;
+
+  if (order > MAX_ORDER)
+    return SIZE_MAX;
+
+  page_idx = alloc_block (pool, order);
+  if (page_idx == SIZE_MAX && !list_empty (&pool->zeroed))
+    {
+      while (!list_empty (&pool->zeroed))
+        free_block (pool, elem_to_idx (pool, list_pop_front (&pool->zeroed)),
+                    0);
+      pool->zeroed_cnt = 0;
+      page_idx = alloc_block (pool, order);
+    }
+
+  /* Free the pages past the end of the request. */
+  if (page_idx != SIZE_MAX)
+    free_range (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Allocates a block of 2**ORDER pages from POOL and returns the
+   index of its first page, or SIZE_MAX if no block is big
+   enough.  POOL's lock must be held. */
+static size_t
+alloc_block (struct pool *pool, int order) 
+{
+  size_t page_idx;
+  int k;
+
+  /* Find the smallest free block that is big enough. */
+  for (k = order; list_empty (&pool->free[k]); k++)
+    if (k == MAX_ORDER)
+      return SIZE_MAX;
+  page_idx = elem_to_idx (pool, list_pop_front (&pool->free[k]));
+  ASSERT (pool->orders[page_idx] == k);
+  pool->orders[page_idx] = NOT_FREE;
+
+  /* Split it, freeing the upper halves. */
+  while (k > order) 
+    {
+      size_t buddy_idx = page_idx + ((size_t) 1 << --k);
+      pool->orders[buddy_idx] = k;
+      list_push_front (&pool->free[k], idx_to_elem (pool, buddy_idx));
+    }
+
+  pool->free_cnt -= (size_t) 1 << order;
+  return page_idx;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy for as long as the buddy is free.  POOL's
+   lock must be held. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  ASSERT (page_idx % ((size_t) 1 << order) == 0);
+  ASSERT (pool->orders[page_idx] == NOT_FREE);
+
+  pool->free_cnt += (size_t) 1 << order;
+  while (order < MAX_ORDER) 
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= pool->page_cnt || pool->orders[buddy_idx] != order)
+        break;
+
+      list_remove (idx_to_elem (pool, buddy_idx));
+      pool->orders[buddy_idx] = NOT_FREE;
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  pool->orders[page_idx] = order;
+  list_push_front (&pool->free[order], idx_to_elem (pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, as the
+   largest blocks that they can be divided into.  POOL's lock
+   must be held. */
+static void
+free_range (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+
+      while (order < MAX_ORDER
+             && page_idx % ((size_t) 2 << order) == 0
+             && (size_t) 2 << order <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Moves a free page in POOL to its pre-zeroed pages, zeroing
+   it with interrupts on, unless POOL already has enough
+   pre-zeroed pages or too few free pages.  Returns true if a
+   page was zeroed.  Returns with the interrupt level it was
+   called with. */
+static bool
+zero_page (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx = SIZE_MAX;
+  uint8_t *page;
+
+  old_level = spinlock_acquire_irqsave (&pool->lock);
+  if (pool->zeroed_cnt < pool->zeroed_max
+      && pool->free_cnt > pool->zeroed_max)
+    page_idx = alloc_block (pool, 0);
+  spinlock_release (&pool->lock);
+  if (page_idx == SIZE_MAX)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  /* The page is allocated, so nobody else touches it while it is
+     zeroed. */
+  page = pool->base + PGSIZE * page_idx;
+  intr_enable ();
+  memset (page, 0, PGSIZE);
+
+  spinlock_acquire_irqsave (&pool->lock);
+  list_push_front (&pool->zeroed, (struct list_elem *) page);
+  pool->zeroed_cnt++;
+  spinlock_release_irqrestore (&pool->lock, old_level);
+  return true;
+}
+
+/* Prints POOL's free pages, its free blocks of each order, and
+   its fragmentation: the percentage of free pages that are not
+   in the largest free block, which is 0 when all of the free
+   pages could be allocated at once. */
+static void
+print_pool_stats (const struct pool *pool) 
+{
+  size_t cnt[MAX_ORDER + 1];
+  size_t largest = 0;
+  int order, top = -1;
+
+  for (order = 0; order <= MAX_ORDER; order++)
+    {
+      cnt[order] = list_size ((struct list *) &pool->free[order]);
+      if (cnt[order] > 0)
+        {
+          top = order;
+          largest = (size_t) 1 << order;
+        }
+    }
+
+  printf ("Palloc %s: %zu of %zu pages free, largest free block %zu, "
+          "%zu%% fragmented\n", pool->name, pool->free_cnt, pool->page_cnt,
+          largest,
+          pool->free_cnt > 0 ? 100 - largest * 100 / pool->free_cnt : 0);
+  printf ("Palloc %s: free blocks by order:", pool->name);
+  for (order = 0; order <= top; order++)
+    printf (" %d:%zu", order, cnt[order]);
+  printf ("\n");
+  printf ("Palloc %s: %zu pre-zeroed pages, %llu PAL_ZERO hits, "
+          "%llu misses\n", pool->name, pool->zeroed_cnt, pool->zero_hits,
+          pool->zero_misses);
+}
@@ -0,0 +1,124 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/thread.h"
+
+/* Statistical sampling profiler.
+
+   With -profile=N, every Nth timer interrupt records where the
+   interrupted code was running: its EIP, whether it was in user
+   or kernel mode, and for user mode the name of the running
+   thread, since every process uses the same range of user
+   addresses.  Samples with the same key are counted in a fixed
+   hash table, so the profiler never allocates memory, and a
+   sample that finds the table full is only counted as dropped.
+
+   At shutdown the most frequent samples are printed.  Kernel
+   addresses can be passed to utils/backtrace along with
+   kernel.o, and user addresses along with the program's ELF
+   binary. */
+
+/* If true, sample the interrupted EIP on timer interrupts. */
+bool profile_enabled;
+
+/* Take a sample every this many timer interrupts. */
+int profile_interval = 1;
+
+#define PROFILE_BUCKETS 1024    /* Size of hash table, a power of 2. */
+#define PROFILE_PROBES 16       /* Most buckets to try per sample. */
+#define PROFILE_PRINT 20        /* Samples printed at shutdown. */
+
+/* A bucket in the sample table. */
+struct sample
+  {
+    uintptr_t eip;              /* Interrupted instruction. */
+    uint32_t count;             /* Times sampled; 0 if bucket unused. */
+    bool user;                  /* In user mode? */
+    char name[16];              /* For user mode, the thread's name. */
+  };
+
+static struct sample samples[PROFILE_BUCKETS];
+static uint32_t sample_cnt;     /* Samples taken. */
+static uint32_t dropped_cnt;    /* Samples not recorded: table full. */
+static int ticks_to_sample;     /* Timer interrupts until next sample. */
+
+/* Called by the timer interrupt handler with the interrupted
+   code's frame F.  Runs in an external interrupt context. */
+void
+profile_tick (const struct intr_frame *f) 
+{
+  bool user = (f->cs & 3) == 3;
+  uintptr_t eip = (uintptr_t) f->eip;
+  const char *name = user ? thread_current ()->name : "";
+  unsigned h, i;
+
+  ASSERT (intr_context ());
+
+  if (--ticks_to_sample > 0)
+    return;
+  ticks_to_sample = profile_interval;
+  sample_cnt++;
+
+  h = (eip ^ user) * 2654435761u;
+  for (i = 0; i < PROFILE_PROBES; i++)
+    {
+      struct sample *s = &samples[(h + i) & (PROFILE_BUCKETS - 1)];
+      if (s->count == 0)
+        {
+          s->eip = eip;
+          s->user = user;
+          strlcpy (s->name, name, sizeof s->name);
+        }
+      else if (s->eip != eip || s->user != user
+               || strcmp (s->name, name))
+        continue;
+      s->count++;
+      return;
+    }
+  dropped_cnt++;
+}
+
+/* Returns the number of samples taken so far. */
+uint32_t
+profile_sample_cnt (void) 
+{
+  return sample_cnt;
+}
+
+/* Prints the PROFILE_PRINT most frequent samples, most frequent
+   first.  Does nothing unless -profile was given.  Stops
+   sampling. */
+void
+profile_print_stats (void) 
+{
+  int i, j;
+
+  if (!profile_enabled)
+    return;
+  profile_enabled = false;
+
+  /* Sort by count.  The table is no longer needed for lookups,
+     so it can be sorted in place. */
+  for (i = 1; i < PROFILE_BUCKETS; i++)
+    {
+      struct sample s = samples[i];
+      for (j = i; j > 0 && samples[j - 1].count < s.count; j--)
+        samples[j] = samples[j - 1];
+      samples[j] = s;
+    }
+
+  printf ("Profile: %"PRIu32" samples every %d ticks, %"PRIu32" dropped\n",
+          sample_cnt, profile_interval, dropped_cnt);
+  printf ("%8s %6s %-6s %-10s %s\n",
+          "samples", "%", "mode", "address", "thread");
+  for (i = 0; i < PROFILE_PRINT && samples[i].count > 0; i++)
+    {
+      const struct sample *s = &samples[i];
+      unsigned permille = (uint64_t) s->count * 1000 / sample_cnt;
+      printf ("%8"PRIu32" %4u.%u %-6s 0x%08"PRIxPTR" %s\n",
+              s->count, permille / 10, permille % 10,
+              s->user ? "user" : "kernel", s->eip, s->name);
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* Statistical sampling profiler.  Controlled by kernel
+   command-line option "-profile[=N]". */
+extern bool profile_enabled;
+extern int profile_interval;
+
+void profile_tick (const struct intr_frame *);
+uint32_t profile_sample_cnt (void);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
@@ -0,0 +1,286 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for fixed-size objects.
+
+   Each cache hands out objects of exactly one size, which makes
+   it a better fit than malloc() for structures such as `struct
+   inode' whose size is not close to a power of 2.  A cache
+   obtains memory a page at a time from the page allocator.  Each
+   page, called a "slab", begins with a header, followed by the
+   objects packed end to end.
+
+   Each slab keeps the indexes of its free objects in a stack in
+   its header, rather than threading a free list through the
+   objects themselves.  That way a free object is never written
+   by the allocator, so an object can be constructed once when
+   its slab is created and still be in its constructed state
+   each time it is allocated again.
+
+   The space left over at the end of a slab is used to "color"
+   slabs: successive slabs start their objects at different
+   offsets, in steps of COLOR_STEP bytes, so that objects at the
+   same index in different slabs do not all compete for the same
+   CPU cache sets.
+
+   A cache keeps the slabs that have free objects on a list,
+   partly used slabs in front, so that allocations fill up slabs
+   that are already in use before touching empty ones.  A slab
+   whose objects are all free is given back to the page
+   allocator, except that each cache holds on to one empty slab
+   to avoid creating and destroying a slab repeatedly when a
+   single object is allocated and freed over and over. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Granularity of slab coloring, the size of a CPU cache line. */
+#define COLOR_STEP 32
+
+/* Slab header, at the beginning of the slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* In cache's list, if any free objects. */
+    uint8_t *objs;              /* First object. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free[];            /* Free object indexes, top is last. */
+  };
+
+/* All caches, for kmem_print_stats(). */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static bool slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Returns the offset of the first object in a slab of OBJ_CNT
+   objects aligned on ALIGN-byte boundaries, before coloring. */
+static size_t
+objs_offset (size_t obj_cnt, size_t align) 
+{
+  return ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+                   align);
+}
+
+/* Returns the step between the colors of slabs in cache C. */
+static size_t
+color_step (const struct kmem_cache *c) 
+{
+  return c->align > COLOR_STEP ? c->align : COLOR_STEP;
+}
+
+/* Initializes C as a cache of SIZE-byte objects aligned on
+   ALIGN-byte boundaries, a power of 2, or on pointer-size
+   boundaries if ALIGN is 0.  If CTOR is nonnull, it is called
+   for each object when its slab is created.  NAME identifies the
+   cache in statistics and must remain valid as long as C.
+
+   SIZE must be small enough that at least one object fits in a
+   page along with the slab header. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name,
+                 size_t size, size_t align, kmem_ctor_func *ctor) 
+{
+  size_t obj_cnt;
+
+  ASSERT (c != NULL);
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  if (align == 0)
+    align = sizeof (void *);
+  ASSERT ((align & (align - 1)) == 0);
+
+  c->name = name;
+  c->align = align;
+  c->obj_size = ROUND_UP (size, align);
+
+  /* Fit as many objects as we can after the header. */
+  obj_cnt = (PGSIZE - sizeof (struct slab))
+             / (c->obj_size + sizeof (uint16_t));
+  while (obj_cnt > 0
+         && objs_offset (obj_cnt, align) + obj_cnt * c->obj_size > PGSIZE)
+    obj_cnt--;
+  ASSERT (obj_cnt > 0);
+  c->obj_cnt = obj_cnt;
+  c->obj_ofs = objs_offset (obj_cnt, align);
+  c->color_max = ROUND_DOWN (PGSIZE - c->obj_ofs - obj_cnt * c->obj_size,
+                             color_step (c));
+  c->color_next = 0;
+
+  c->ctor = ctor;
+  list_init (&c->slabs);
+  c->empty_cnt = 0;
+  lock_init_named (&c->lock, name);
+
+  c->alloc_cnt = 0;
+  c->active_cnt = c->active_max = 0;
+  c->slab_cnt = c->slab_max = 0;
+  list_push_back (&all_caches, &c->allelem);
+}
+
+/* Allocates and returns an object from cache C.  If C has a
+   constructor, the object is in its constructed state;
+   otherwise, its contents are undefined.  Returns a null pointer
+   if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (list_empty (&c->slabs) && !slab_create (c))
+    {
+      lock_release (&c->lock);
+      return NULL;
+    }
+
+  s = list_entry (list_front (&c->slabs), struct slab, elem);
+  if (s->free_cnt == c->obj_cnt)
+    c->empty_cnt--;
+  obj = s->objs + s->free[--s->free_cnt] * c->obj_size;
+  if (s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  c->alloc_cnt++;
+  if (++c->active_cnt > c->active_max)
+    c->active_max = c->active_cnt;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  If C has a constructor, OBJ must be in its constructed
+   state.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     that would destroy its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->free_cnt < c->obj_cnt);
+  if (s->free_cnt == 0)
+    list_push_front (&c->slabs, &s->elem);
+  s->free[s->free_cnt++] = ((uint8_t *) obj - s->objs) / c->obj_size;
+  c->active_cnt--;
+
+  /* If the slab is now entirely unused, keep it if it is the
+     only empty one, otherwise free it. */
+  if (s->free_cnt == c->obj_cnt)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt > 0)
+        {
+          s->magic = 0;
+          c->slab_cnt--;
+          palloc_free_page (s);
+        }
+      else
+        {
+          c->empty_cnt++;
+          list_push_back (&c->slabs, &s->elem);
+        }
+    }
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache that has been used, with the
+   number of pages that malloc() would have needed for the same
+   peak number of objects. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, allelem);
+
+      if (c->alloc_cnt == 0)
+        continue;
+      printf ("Slab %s: %zu-byte objects, %zu per slab, %llu allocs, "
+              "%zu active (max %zu), peak %zu pages vs. %zu with malloc\n",
+              c->name, c->obj_size, c->obj_cnt, c->alloc_cnt,
+              c->active_cnt, c->active_max, c->slab_max,
+              malloc_page_cnt (c->obj_size, c->active_max));
+    }
+}
+
+/* Adds a new slab to cache C, constructing each of its objects.
+   Returns true if successful, false if memory is not
+   available. */
+static bool
+slab_create (struct kmem_cache *c) 
+{
+  struct slab *s;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return false;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->objs = (uint8_t *) s + c->obj_ofs + c->color_next;
+  c->color_next += color_step (c);
+  if (c->color_next > c->color_max)
+    c->color_next = 0;
+
+  /* Stack the indexes so that objects are handed out in address
+     order. */
+  s->free_cnt = c->obj_cnt;
+  for (i = 0; i < c->obj_cnt; i++)
+    s->free[i] = c->obj_cnt - 1 - i;
+  if (c->ctor != NULL)
+    for (i = 0; i < c->obj_cnt; i++)
+      c->ctor (s->objs + i * c->obj_size);
+
+  list_push_front (&c->slabs, &s->elem);
+  c->empty_cnt++;
+  if (++c->slab_cnt > c->slab_max)
+    c->slab_max = c->slab_cnt;
+  return true;
+}
+
+/* Returns the slab that contains OBJ, which must be an object
+   in cache C. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT ((uint8_t *) obj >= s->objs);
+  ASSERT (((uint8_t *) obj - s->objs) % c->obj_size == 0);
+  ASSERT (((uint8_t *) obj - s->objs) / c->obj_size < c->obj_cnt);
+
+  return s;
+}
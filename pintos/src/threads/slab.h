@@ -0,0 +1,47 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Constructor for the objects in a cache.  Called once for each
+   object when its slab is created, not on every allocation, so
+   an object must be returned to its cache in the state that the
+   constructor leaves it in. */
+typedef void kmem_ctor_func (void *obj);
+
+/* A cache of objects of a single size.  Objects are carved out
+   of one-page slabs, so unlike malloc() there is no rounding to
+   a power of 2. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size, a multiple of ALIGN. */
+    size_t align;               /* Object alignment. */
+    size_t obj_cnt;             /* Objects per slab. */
+    size_t obj_ofs;             /* Offset of first object, uncolored. */
+    size_t color_max;           /* Largest color offset. */
+    size_t color_next;          /* Color offset for next slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct list slabs;          /* Slabs with free objects. */
+    size_t empty_cnt;           /* Slabs with no objects in use. */
+    struct lock lock;           /* Guards the slabs. */
+    struct list_elem allelem;   /* Element in list of caches. */
+
+    /* Statistics. */
+    uint64_t alloc_cnt;         /* Objects ever allocated. */
+    size_t active_cnt;          /* Objects allocated now. */
+    size_t active_max;          /* Most objects allocated at once. */
+    size_t slab_cnt;            /* Slabs now. */
+    size_t slab_max;            /* Most slabs at once. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name,
+                      size_t size, size_t align, kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
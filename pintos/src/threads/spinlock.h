@@ -0,0 +1,79 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* A spinlock.
+
+   A spinlock protects short critical sections against other
+   CPUs.  Against interrupts on the same CPU it protects nothing,
+   so code that may race with an interrupt handler must use
+   spinlock_acquire_irqsave(), which also turns interrupts off.
+   So must any spinlock that more than one thread may take: the
+   kernel can prevent preemption only by turning interrupts off,
+   and a thread preempted while holding a spinlock could leave a
+   higher-priority thread spinning on it forever.  A spinlock
+   must never be held across thread_block(), thread_yield(), or
+   any other call that may sleep or switch threads.
+
+   On a uniprocessor the lock is never contended, so acquiring
+   it costs a single locked exchange. */
+struct spinlock 
+  {
+    volatile uint32_t locked;   /* 1 if held, 0 if free. */
+  };
+
+/* Initializes spinlock L to the unlocked state. */
+static inline void
+spinlock_init (struct spinlock *l) 
+{
+  l->locked = 0;
+}
+
+/* Atomically stores NEW into *P and returns its old value.
+   See [IA32-v2b] "XCHG": it is locked even without a prefix. */
+static inline uint32_t
+spinlock_xchg (volatile uint32_t *p, uint32_t new) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Acquires L, spinning until it is free. */
+static inline void
+spinlock_acquire (struct spinlock *l) 
+{
+  while (spinlock_xchg (&l->locked, 1) != 0)
+    while (l->locked)
+      asm volatile ("pause" : : : "memory");
+}
+
+/* Releases L, which must be held. */
+static inline void
+spinlock_release (struct spinlock *l) 
+{
+  ASSERT (l->locked);
+  spinlock_xchg (&l->locked, 0);
+}
+
+/* Turns interrupts off, acquires L, and returns the previous
+   interrupt level. */
+static inline enum intr_level
+spinlock_acquire_irqsave (struct spinlock *l) 
+{
+  enum intr_level old_level = intr_disable ();
+  spinlock_acquire (l);
+  return old_level;
+}
+
+/* Releases L and restores interrupt level OLD_LEVEL. */
+static inline void
+spinlock_release_irqrestore (struct spinlock *l, enum intr_level old_level) 
+{
+  spinlock_release (l);
+  intr_set_level (old_level);
+}
+
+#endif /* threads/spinlock.h */
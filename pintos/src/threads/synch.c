@@ -30,7 +30,78 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
+
+/* Wait queues.
+
+   The waiters of a semaphore or condition variable are kept in a
+   list ordered by descending priority, FIFO among equals, so the
+   waiter to wake is always at the front.  A thread's priority can
+   change while it waits, through donation or the MLFQS, so each
+   waiting thread records where it is queued and is moved when
+   that happens.
+
+   Each semaphore, lock, rwlock and condition variable guards its
+   own state with a spinlock.  Priority donation and requeuing,
+   however, reach across objects: they update the priorities of
+   lock holders and move waiters in queues whose guards they do
+   not take.  They rely on running with interrupts off, which
+   every guard's holder has, and so are correct only on one
+   CPU. */
+
+/* Inserts ELEM into wait queue LIST, ordered by LESS, behind
+   every element of equal or higher priority.  Scans from the
+   back, so queuing behind waiters of the same priority, the
+   common case, takes constant time. */
+static void
+waitq_insert (struct list *list, struct list_elem *elem,
+              list_less_func *less) 
+{
+  struct list_elem *e = list_rbegin (list);
+
+  while (e != list_rend (list) && less (e, elem, NULL))
+    e = list_prev (e);
+  list_insert (list_next (e), elem);
+}
+
+/* Records that T waits in LIST, ordered by LESS, as ELEM. */
+static void
+waitq_track (struct thread *t, struct list *list, struct list_elem *elem,
+             list_less_func *less) 
+{
+  t->wait_list = list;
+  t->wait_elem = elem;
+  t->wait_less = less;
+}
+
+/* Moves blocked thread T to the right place in the wait queue it
+   is in, if any, after its priority changed.  Must be called
+   with interrupts off. */
+void
+synch_requeue_waiter (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->wait_list != NULL)
+    {
+      list_remove (t->wait_elem);
+      waitq_insert (t->wait_list, t->wait_elem, t->wait_less);
+    }
+}
+
+/* Returns true if the thread waiting as A has lower priority
+   than the one waiting as B, for semaphore wait queues. */
+static bool
+sema_waiter_less (const struct list_elem *a, const struct list_elem *b,
+                  void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->priority
+          < list_entry (b, struct thread, elem)->priority);
+}
+
+static void donate_priority (struct thread *, int depth);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,6 +119,7 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  spinlock_init (&sema->guard);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -65,63 +137,31 @@ sema_down (struct semaphore *sema)
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
-  old_level = intr_disable ();
+  old_level = spinlock_acquire_irqsave (&sema->guard);
   while (sema->value == 0) 
     {
-
-	int depth = 0;
-	struct thread *current_thread = thread_current();
-	struct lock* current_lock = thread_current()->waiting_lock;
-	/*
-	if(current_lock)
-	{
-	    if(current_lock->holder)
-	    {
-		if(current_lock->holder->priority < current_thread->priority)
-		{
-		    
-		    current_lock->holder->priority = current_thread->priority;
-
-		}
-	    }
-	}
-	*/
-	
-	while(current_lock && depth < 8)
-	{
-	    depth++;
-	    if(!current_lock->holder)
-		break;
-	    if(current_lock->holder->priority < current_thread->priority)
-	    {
-		//current_thread->donated_priority = true;
-		current_lock->holder->priority = current_thread->priority;
-		current_thread = current_lock->holder;
-		current_lock = current_thread->waiting_lock;
-		
-	    }
-	}
-	
-	
-	//list_push_back (&sema->waiters, &thread_current ()->elem);
-	
-	struct thread *t = thread_current();
-	struct list_elem* e;
-	for(e = list_begin (&sema->waiters); e != list_end(&sema->waiters);
-	    e = list_next(e))
-	{
-	    if(list_entry(e, struct thread, elem)->priority < t->priority)
-	    {
-		break;
-	    }
-	}
-	list_insert(e, &t->elem);
-	
-	thread_block ();
-	//thread_yield();
+      struct thread *t = thread_current ();
+      bool track;
+
+      /* Waiting for a lock donates our priority to its holder. */
+      if (t->waiting_lock != NULL && !thread_mlfqs)
+        donate_priority (t, 0);
+
+      /* A thread in cond_wait() is tracked in the condition
+         variable's queue instead of its private semaphore's. */
+      track = t->wait_list == NULL;
+      waitq_insert (&sema->waiters, &t->elem, sema_waiter_less);
+      if (track)
+        waitq_track (t, &sema->waiters, &t->elem, sema_waiter_less);
+
+      spinlock_release (&sema->guard);
+      thread_block ();
+      spinlock_acquire (&sema->guard);
+      if (track)
+        t->wait_list = NULL;
     }
   sema->value--;
-  intr_set_level (old_level);
+  spinlock_release_irqrestore (&sema->guard, old_level);
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -137,7 +177,7 @@ sema_try_down (struct semaphore *sema)
 
   ASSERT (sema != NULL);
 
-  old_level = intr_disable ();
+  old_level = spinlock_acquire_irqsave (&sema->guard);
   if (sema->value > 0) 
     {
       sema->value--;
@@ -145,7 +185,7 @@ sema_try_down (struct semaphore *sema)
     }
   else
     success = false;
-  intr_set_level (old_level);
+  spinlock_release_irqrestore (&sema->guard, old_level);
 
   return success;
 }
@@ -161,44 +201,14 @@ sema_up (struct semaphore *sema)
 
   ASSERT (sema != NULL);
 
-  old_level = intr_disable ();
+  old_level = spinlock_acquire_irqsave (&sema->guard);
 
+  /* The highest-priority waiter is at the front. */
   if (!list_empty (&sema->waiters)) 
-  {
-      //find the highest priority thread
-      
-      struct thread *ret = list_entry(list_front(&sema->waiters),struct thread, elem);
-      struct list_elem *e;
-
-      ASSERT (intr_get_level () == INTR_OFF);
-      int max_priority = ret->priority;
-      for (e = list_begin (&sema->waiters); e != list_end (&sema->waiters);
-	   e = list_next (e))
-      {
-	  struct thread *t = list_entry(e, struct thread, elem);
-	  if(t->priority > max_priority)
-	  {
-	      ret = t;
-	      max_priority = t->priority;
-	  }
-      }
-      thread_unblock(ret);
-      
-      //list_remove(&ret->elem);
-
-
-      
-      //thread_unblock (list_entry (list_pop_front (&sema->waiters),
-      //                        struct thread, elem));
-      
-      //struct thread *ret = list_entry(list_pop_front(&sema->waiters),struct thread, elem);
-
-      //ret->priority = ret->initial_priority;
-      //thread_unblock(ret);        
-
-      
-  }
+    thread_unblock (list_entry (list_pop_front (&sema->waiters),
+                                struct thread, elem));
   sema->value++;
+  spinlock_release (&sema->guard);
   if(!intr_context())
   thread_yield();
   intr_set_level (old_level);
@@ -263,7 +273,148 @@ lock_init (struct lock *lock)
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
-  list_init(&lock->donators);
+  lock->max_priority = PRI_MIN;
+  lock->name = NULL;
+  memset (&lock->stats, 0, sizeof lock->stats);
+  spinlock_init (&lock->guard);
+}
+
+/* If true, collect per-lock contention statistics.
+   Controlled by kernel command-line option "-lockstat". */
+bool lockstat_enabled;
+
+/* List of all named locks, for lock_print_stats(). */
+static struct list named_locks = LIST_INITIALIZER (named_locks);
+static struct spinlock named_locks_guard;
+
+/* Initializes LOCK like lock_init() and gives it NAME, so that
+   its contention statistics appear in lock_print_stats().  The
+   lock is registered permanently, so it must never be freed;
+   this is meant for locks with static storage duration or that
+   live as long as the kernel. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+
+  lock_init (lock);
+  lock->name = name;
+
+  old_level = spinlock_acquire_irqsave (&named_locks_guard);
+  list_push_back (&named_locks, &lock->statelem);
+  spinlock_release_irqrestore (&named_locks_guard, old_level);
+}
+
+/* Records that LOCK was just acquired by the running thread
+   after waiting WAIT cycles, of which CONTENDED tells whether
+   the wait was due to another holder. */
+static void
+lockstat_acquired (struct lock *lock, bool contended, uint64_t wait) 
+{
+  struct lock_stats *st = &lock->stats;
+
+  st->acquisitions++;
+  if (contended)
+    {
+      st->contended++;
+      st->wait_total += wait;
+      if (wait > st->wait_max)
+        st->wait_max = wait;
+    }
+  st->acquired_at = rdtsc ();
+}
+
+/* Records that LOCK is about to be released. */
+static void
+lockstat_released (struct lock *lock) 
+{
+  struct lock_stats *st = &lock->stats;
+  uint64_t hold = rdtsc () - st->acquired_at;
+
+  st->hold_total += hold;
+  if (hold > st->hold_max)
+    st->hold_max = hold;
+}
+
+/* Maximum length of a chain of locks that priority is donated
+   along, bounding the cost of nested donation. */
+#define DONATE_DEPTH 8
+
+/* Raises HOLDER's priority to PRIORITY, if that is higher, and
+   passes the donation on to whatever HOLDER is waiting for. */
+static void
+donate_to_holder (struct thread *holder, int priority, int depth) 
+{
+  if (holder != NULL && holder->priority < priority)
+    {
+      thread_update_priority (holder, priority);
+      donate_priority (holder, depth + 1);
+    }
+}
+
+/* Donates T's priority to the holder of the lock T is waiting
+   for, or to the writer or every reader of the rwlock T is
+   waiting for, and onward through whatever those holders are
+   waiting for, up to DONATE_DEPTH locks deep.  Each lock
+   remembers the highest priority donated to it, so that a
+   release can recompute its holder's priority from the locks it
+   still holds.  DEPTH is the number of locks already passed
+   through.  Must be called with interrupts off. */
+static void
+donate_priority (struct thread *t, int depth) 
+{
+  int priority = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (depth >= DONATE_DEPTH)
+    return;
+
+  if (t->waiting_lock != NULL)
+    {
+      struct lock *lock = t->waiting_lock;
+
+      if (lock->max_priority >= priority)
+        return;
+      lock->max_priority = priority;
+      donate_to_holder (lock->holder, priority, depth);
+    }
+  else if (t->waiting_rwlock != NULL)
+    {
+      struct rwlock *rw = t->waiting_rwlock;
+      struct list_elem *e;
+
+      if (rw->max_priority >= priority)
+        return;
+      rw->max_priority = priority;
+      donate_to_holder (rw->writer, priority, depth);
+      for (e = list_begin (&rw->readers); e != list_end (&rw->readers);
+           e = list_next (e))
+        donate_to_holder (list_entry (e, struct rwlock_hold, elem)->thread,
+                          priority, depth);
+    }
+}
+
+/* Makes T the holder of LOCK.  The highest-priority remaining
+   waiter, if any, is at the front of the semaphore's wait queue
+   and keeps donating to T through LOCK. */
+static void
+lock_grant (struct lock *lock, struct thread *t) 
+{
+  struct list *waiters = &lock->semaphore.waiters;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = t;
+  lock->max_priority = PRI_MIN;
+  if (!list_empty (waiters))
+    lock->max_priority = list_entry (list_front (waiters),
+                                     struct thread, elem)->priority;
+  list_push_back (&t->held_locks, &lock->holdelem);
+  if (!thread_mlfqs && lock->max_priority > t->priority)
+    thread_update_priority (t, lock->max_priority);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -277,34 +428,31 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool contended;
+  uint64_t wait_start;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
-  enum intr_level old_level = intr_disable();
-  if(lock->holder)
-  {
-      thread_current()->waiting_lock = lock;
-      //add to donators
-      //list_push_back(&lock->donators,&thread_current()->donateelem);
-      struct thread *t = thread_current();
-      struct list_elem* e;
-      for(e = list_begin (&lock->holder->donaters); e != list_end(&lock->holder->donaters);
-	  e = list_next(e))
-      {
-	  if(list_entry(e, struct thread, elem)->priority < t->priority)
-	  {
-	      break;
-	  }
-      }
-      list_insert(e, &t->donateelem);
-      //printf("%d",thread_current()->priority);
-  }
 
+  old_level = spinlock_acquire_irqsave (&lock->guard);
+  contended = lock->holder != NULL;
+  wait_start = lockstat_enabled ? rdtsc () : 0;
+
+  /* sema_down() donates along WAITING_LOCK each time it has to
+     wait, including after losing a race for a released lock. */
+  cur->waiting_lock = lock;
+  spinlock_release (&lock->guard);
   sema_down (&lock->semaphore);
-  thread_current()->waiting_lock = 0;
-  lock->holder = thread_current ();
+  spinlock_acquire (&lock->guard);
+  cur->waiting_lock = NULL;
+  lock_grant (lock, cur);
+  if (lockstat_enabled)
+    lockstat_acquired (lock, contended, rdtsc () - wait_start);
 
-  intr_set_level(old_level);
+  spinlock_release_irqrestore (&lock->guard, old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -323,7 +471,13 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = spinlock_acquire_irqsave (&lock->guard);
+      lock_grant (lock, thread_current ());
+      if (lockstat_enabled)
+        lockstat_acquired (lock, false, 0);
+      spinlock_release_irqrestore (&lock->guard, old_level);
+    }
   return success;
 }
 
@@ -335,32 +489,27 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
-  lock->holder->priority = lock->holder->initial_priority;
-  struct list_elem* e;
-  if(!list_empty(&lock->holder->donaters))
-  {
-      
-      for(e = list_begin (&lock->holder->donaters); e != list_end(&lock->holder->donaters);
-	      e = list_next(e))
-      {
-	  struct thread *t = list_entry(e, struct thread, donateelem);
-	  //printf("%d",t->initial_priority);
-	  if(t->waiting_lock == lock)
-	      list_remove(&t->donateelem);
-      }
-      
-      e = list_begin(&lock->holder->donaters);
-      struct thread *t = list_entry(e, struct thread, donateelem);
-      if(t->priority > lock->holder->priority)
-	  lock->holder->priority = t->priority;
-  }
-  lock->holder = NULL;  
-  
-  enum intr_level old_level = intr_disable();
+
+  old_level = spinlock_acquire_irqsave (&lock->guard);
+  if (lockstat_enabled)
+    lockstat_released (lock);
+
+  /* Give up whatever was donated through LOCK. */
+  list_remove (&lock->holdelem);
+  lock->holder = NULL;
+  if (!thread_mlfqs)
+    thread_recompute_priority (cur);
+  spinlock_release (&lock->guard);
+
+  /* sema_up() may yield, which must not happen with the guard
+     held. */
   sema_up (&lock->semaphore);
-  intr_set_level(old_level);
+  intr_set_level (old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -374,14 +523,363 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Returns true if named lock A has seen more contention than
+   named lock B, breaking ties by acquisition count. */
+static bool
+lock_more_contended (const struct list_elem *a_, const struct list_elem *b_,
+                     void *aux UNUSED) 
+{
+  const struct lock *a = list_entry (a_, struct lock, statelem);
+  const struct lock *b = list_entry (b_, struct lock, statelem);
+
+  if (a->stats.contended != b->stats.contended)
+    return a->stats.contended > b->stats.contended;
+  return a->stats.acquisitions > b->stats.acquisitions;
+}
+
+/* Prints contention statistics for every named lock, most
+   contended first.  Does nothing unless -lockstat was given. */
+void
+lock_print_stats (void) 
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+
+  if (!lockstat_enabled)
+    return;
+
+  old_level = spinlock_acquire_irqsave (&named_locks_guard);
+  list_sort (&named_locks, lock_more_contended, NULL);
+  spinlock_release_irqrestore (&named_locks_guard, old_level);
+
+  printf ("Lock statistics (times in cycles):\n");
+  printf ("%-16s %10s %10s %12s %12s %12s %12s\n", "name", "acquired",
+          "contended", "wait avg", "wait max", "hold avg", "hold max");
+  for (e = list_begin (&named_locks); e != list_end (&named_locks);
+       e = list_next (e))
+    {
+      const struct lock *lock = list_entry (e, struct lock, statelem);
+      const struct lock_stats *st = &lock->stats;
+
+      printf ("%-16s %10llu %10llu %12llu %12llu %12llu %12llu\n",
+              lock->name, st->acquisitions, st->contended,
+              st->contended ? st->wait_total / st->contended : 0,
+              st->wait_max,
+              st->acquisitions ? st->hold_total / st->acquisitions : 0,
+              st->hold_max);
+    }
+}
+
+/* Initializes readers-writer lock RW. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  rw->writer = NULL;
+  list_init (&rw->readers);
+  rw->reader_cnt = 0;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+  rw->max_priority = PRI_MIN;
+  spinlock_init (&rw->guard);
+}
+
+/* Returns T's hold on RW, or a null pointer if T does not hold
+   RW. */
+static struct rwlock_hold *
+rwlock_find_hold (struct thread *t, const struct rwlock *rw) 
+{
+  int i;
+
+  for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+    if (t->rw_holds[i].rwlock == rw)
+      return &t->rw_holds[i];
+  return NULL;
+}
+
+/* Recomputes the highest priority donated to RW, which is that
+   of the first thread in either of its wait queues. */
+static void
+rwlock_update_max_priority (struct rwlock *rw) 
+{
+  rw->max_priority = PRI_MIN;
+  if (!list_empty (&rw->read_waiters))
+    rw->max_priority = list_entry (list_front (&rw->read_waiters),
+                                   struct thread, elem)->priority;
+  if (!list_empty (&rw->write_waiters))
+    {
+      int priority = list_entry (list_front (&rw->write_waiters),
+                                 struct thread, elem)->priority;
+      if (priority > rw->max_priority)
+        rw->max_priority = priority;
+    }
+}
+
+/* Records that T now holds RW, for reading unless WRITE.
+
+   If T already tracks RWLOCK_HOLD_MAX holds, it still gets RW,
+   but untracked: as a reader it receives no donations through
+   RW, and as the writer it keeps RW's donations only until its
+   priority is next recomputed.  That only matters for priority
+   scheduling, and only while T holds that many rwlocks. */
+static void
+rwlock_grant (struct rwlock *rw, struct thread *t, bool write) 
+{
+  struct rwlock_hold *hold = rwlock_find_hold (t, NULL);
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (hold != NULL)
+    {
+      hold->rwlock = rw;
+      hold->thread = t;
+    }
+  if (write)
+    rw->writer = t;
+  else
+    {
+      if (hold != NULL)
+        list_push_back (&rw->readers, &hold->elem);
+      rw->reader_cnt++;
+    }
+  rwlock_update_max_priority (rw);
+  if (!thread_mlfqs && rw->max_priority > t->priority)
+    thread_update_priority (t, rw->max_priority);
+}
+
+/* Blocks the running thread in wait queue LIST of RW until a
+   releasing thread grants it the lock.  RW's guard must be held;
+   it is dropped while the thread sleeps. */
+static void
+rwlock_wait (struct rwlock *rw, struct list *list) 
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  waitq_insert (list, &t->elem, sema_waiter_less);
+  waitq_track (t, list, &t->elem, sema_waiter_less);
+  t->waiting_rwlock = rw;
+  if (!thread_mlfqs)
+    donate_priority (t, 0);
+  spinlock_release (&rw->guard);
+  thread_block ();
+  spinlock_acquire (&rw->guard);
+}
+
+/* Removes the first thread from wait queue LIST, grants it RW
+   and wakes it up. */
+static void
+rwlock_wake (struct rwlock *rw, struct list *list, bool write) 
+{
+  struct thread *t = list_entry (list_pop_front (list), struct thread, elem);
+
+  t->wait_list = NULL;
+  t->waiting_rwlock = NULL;
+  rwlock_grant (rw, t, write);
+  thread_unblock (t);
+}
+
+/* Hands RW, which nobody holds, to its waiters: to every waiting
+   reader if PREFER_READERS, otherwise to the first waiting
+   writer, falling back to the other kind if there are none.
+   Returns true if any thread was woken, in which case the caller
+   should yield, as sema_up() does, once it has dropped RW's
+   guard. */
+static bool
+rwlock_hand_off (struct rwlock *rw, bool prefer_readers) 
+{
+  bool woke = false;
+
+  ASSERT (rw->writer == NULL && rw->reader_cnt == 0);
+
+  if (prefer_readers || list_empty (&rw->write_waiters))
+    while (!list_empty (&rw->read_waiters))
+      {
+        rwlock_wake (rw, &rw->read_waiters, false);
+        woke = true;
+      }
+  if (!woke && !list_empty (&rw->write_waiters))
+    {
+      rwlock_wake (rw, &rw->write_waiters, true);
+      woke = true;
+    }
+  rwlock_update_max_priority (rw);
+  return woke;
+}
+
+/* Gives up the running thread's hold on RW, if it is tracked,
+   and recomputes its priority without RW's donations. */
+static void
+rwlock_drop_hold (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = rwlock_find_hold (cur, rw);
+
+  if (hold != NULL)
+    hold->rwlock = NULL;
+  if (!thread_mlfqs)
+    thread_recompute_priority (cur);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  Read locks are not recursive: a thread
+   that already holds RW must not acquire it again.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rwlock_find_hold (thread_current (), rw) == NULL);
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  if (rw->writer == NULL && list_empty (&rw->write_waiters))
+    rwlock_grant (rw, thread_current (), false);
+  else
+    rwlock_wait (rw, &rw->read_waiters);
+  spinlock_release_irqrestore (&rw->guard, old_level);
+}
+
+/* Tries to acquire RW for reading without sleeping.  Returns
+   true if successful, false if a writer holds or awaits it. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_find_hold (thread_current (), rw) == NULL);
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  success = rw->writer == NULL && list_empty (&rw->write_waiters);
+  if (success)
+    rwlock_grant (rw, thread_current (), false);
+  spinlock_release_irqrestore (&rw->guard, old_level);
+  return success;
+}
+
+/* Releases RW, which the running thread holds for reading.  The
+   last reader out hands the lock to a waiting writer. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  struct rwlock_hold *hold;
+  enum intr_level old_level;
+  bool woke = false;
+
+  ASSERT (rw != NULL);
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  hold = rwlock_find_hold (thread_current (), rw);
+  ASSERT (rw->writer == NULL && rw->reader_cnt > 0);
+  if (hold != NULL)
+    list_remove (&hold->elem);
+  rwlock_drop_hold (rw);
+  if (--rw->reader_cnt == 0)
+    woke = rwlock_hand_off (rw, false);
+  spinlock_release (&rw->guard);
+  if (woke && !intr_context ())
+    thread_yield ();
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rwlock_find_hold (thread_current (), rw) == NULL);
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  if (rw->writer == NULL && rw->reader_cnt == 0)
+    rwlock_grant (rw, thread_current (), true);
+  else
+    rwlock_wait (rw, &rw->write_waiters);
+  spinlock_release_irqrestore (&rw->guard, old_level);
+}
+
+/* Tries to acquire RW for writing without sleeping.  Returns
+   true if successful, false if any other thread holds it. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool success;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_find_hold (thread_current (), rw) == NULL);
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  success = rw->writer == NULL && rw->reader_cnt == 0;
+  if (success)
+    rwlock_grant (rw, thread_current (), true);
+  spinlock_release_irqrestore (&rw->guard, old_level);
+  return success;
+}
+
+/* Releases RW, which the running thread holds for writing.
+   Waiting readers are admitted first, then waiting writers. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+  bool woke;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_by_current_thread (rw));
+
+  old_level = spinlock_acquire_irqsave (&rw->guard);
+  rw->writer = NULL;
+  rwlock_drop_hold (rw);
+  woke = rwlock_hand_off (rw, true);
+  spinlock_release (&rw->guard);
+  if (woke && !intr_context ())
+    thread_yield ();
+  intr_set_level (old_level);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_by_current_thread (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem 
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
-      int priority;
+    struct thread *thread;              /* Waiting thread. */
   };
 
+/* Returns true if the thread waiting as A has lower priority
+   than the one waiting as B, for condition variable queues. */
+static bool
+cond_waiter_less (const struct list_elem *a, const struct list_elem *b,
+                  void *aux UNUSED) 
+{
+  return (list_entry (a, struct semaphore_elem, elem)->thread->priority
+          < list_entry (b, struct semaphore_elem, elem)->thread->priority);
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -391,6 +889,7 @@ cond_init (struct condition *cond)
   ASSERT (cond != NULL);
 
   list_init (&cond->waiters);
+  spinlock_init (&cond->guard);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -417,28 +916,25 @@ void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  waiter.priority = lock->holder->priority;
+
   sema_init (&waiter.semaphore, 0);
-  //list_push_back (&cond->waiters, &waiter.elem);
-  //stop right there criminal scum
-  //insert sort this first
-      struct list_elem* e;
-      for(e = list_begin (&cond->waiters); e != list_end(&cond->waiters);
-	  e = list_next(e))
-      {
-	  if(list_entry(e, struct semaphore_elem, elem)->priority < waiter.priority)
-	  {
-	      break;
-	  }
-      }
-      list_insert(e, &waiter.elem);
+  waiter.thread = thread_current ();
+
+  /* Donation may requeue waiters at any time, so the queue is
+     modified under its guard with interrupts off even though
+     LOCK is held. */
+  old_level = spinlock_acquire_irqsave (&cond->guard);
+  waitq_insert (&cond->waiters, &waiter.elem, cond_waiter_less);
+  waitq_track (waiter.thread, &cond->waiters, &waiter.elem,
+               cond_waiter_less);
+  spinlock_release_irqrestore (&cond->guard, old_level);
 
-  
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -454,35 +950,25 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  struct semaphore_elem *waiter = NULL;
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = spinlock_acquire_irqsave (&cond->guard);
   if (!list_empty (&cond->waiters)) 
-  {
-      
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
-
-      
-      /*
-      struct list_elem *e = list_front(&cond->waiters);
-      struct semaphore_elem *ret = list_entry(e, struct semaphore_elem, elem);
-      int max_priority = ret->priority;
-      for(e = list_begin (&cond->waiters); e != list_end(&cond->waiters);
-	      e = list_next(e))
-      {
-	  struct semaphore_elem *t = list_entry(e, struct semaphore_elem,elem);
-	  if(t->priority > max_priority)
-	  {
-	      max_priority = t->priority;
-	      ret = t;
-	  }
-      }
-      list_remove(e);
-      sema_up(&ret->semaphore);*/
-  }
+    {
+      waiter = list_entry (list_pop_front (&cond->waiters),
+                           struct semaphore_elem, elem);
+      waiter->thread->wait_list = NULL;
+    }
+  spinlock_release_irqrestore (&cond->guard, old_level);
+
+  if (waiter != NULL)
+    sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -3,12 +3,17 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct spinlock guard;      /* Protects VALUE and WAITERS. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -16,25 +21,93 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
+void synch_requeue_waiter (struct thread *);
+
+/* Contention statistics kept for a named lock when the kernel
+   is booted with -lockstat.  Times are in TSC cycles. */
+struct lock_stats
+  {
+    uint64_t acquisitions;      /* Times the lock was acquired. */
+    uint64_t contended;         /* Acquisitions that had to wait. */
+    uint64_t wait_total;        /* Cycles spent waiting, summed. */
+    uint64_t wait_max;          /* Longest single wait. */
+    uint64_t hold_total;        /* Cycles the lock was held, summed. */
+    uint64_t hold_max;          /* Longest single hold. */
+    uint64_t acquired_at;       /* TSC when the current holder got it. */
+  };
 
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
-      struct list donators;
+    int max_priority;           /* Highest priority donated by waiters. */
+    struct list_elem holdelem;  /* Element in holder's held_locks. */
+    const char *name;           /* Name for -lockstat, or null. */
+    struct list_elem statelem;  /* Element in list of named locks. */
+    struct lock_stats stats;    /* Contention statistics. */
+    struct spinlock guard;      /* Protects HOLDER, MAX_PRIORITY, STATS. */
   };
 
+/* If true, collect per-lock contention statistics.
+   Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+
+/* Readers-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  Once a writer is waiting, new
+   readers wait behind it, so that a steady stream of readers
+   cannot starve writers; releasing the write lock admits every
+   waiting reader, so writers cannot starve readers either.
+   Waiters donate their priority to the writer or to every
+   reader holding the lock. */
+struct rwlock
+  {
+    struct thread *writer;      /* Thread holding it for writing. */
+    struct list readers;        /* rwlock_hold of each reader. */
+    unsigned reader_cnt;        /* Number of threads holding it to read. */
+    struct list read_waiters;   /* Threads waiting to read. */
+    struct list write_waiters;  /* Threads waiting to write. */
+    int max_priority;           /* Highest priority donated by waiters. */
+    struct spinlock guard;      /* Protects all of the above. */
+  };
+
+/* Maximum number of rwlocks whose holds one thread tracks at
+   once.  A thread may hold more, with reduced priority donation;
+   see rwlock_grant(). */
+#define RWLOCK_HOLD_MAX 8
+
+/* A thread's hold on an rwlock, embedded in struct thread.
+   Lets readers be found for donation and held rwlocks be
+   considered when recomputing priority. */
+struct rwlock_hold
+  {
+    struct rwlock *rwlock;      /* Held rwlock, or null if unused. */
+    struct thread *thread;      /* Holding thread. */
+    struct list_elem elem;      /* Element in rwlock's readers. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_by_current_thread (const struct rwlock *);
 
 /* Condition variable. */
 struct condition 
   {
     struct list waiters;        /* List of waiting threads. */
+    struct spinlock guard;      /* Protects WAITERS. */
   };
 
 void cond_init (struct condition *);
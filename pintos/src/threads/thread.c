@@ -1,5 +1,6 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
 #include <stdio.h>
@@ -10,7 +11,9 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,15 +23,24 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   ready_bitmap is set exactly when ready_queues[P] is nonempty,
+   so the highest-priority ready thread can be found without
+   looking at any other thread. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* Number of threads in ready_queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-//sleep list
+/* List of threads sleeping in timer_sleep(), ordered by
+   wake-up tick, earliest first.  The timer interrupt only has to
+   look at the front of the list. */
 static struct list sleep_list;
 
 /* Idle thread. */
@@ -37,8 +49,29 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* If true, keep per-thread scheduler statistics.
+   Controlled by kernel command-line option "-schedstat". */
+bool schedstat_enabled;
+
+/* Histogram of wake-up latency, the time from thread_unblock()
+   until the thread runs, by the woken thread's priority.  Bucket
+   B counts latencies of 2**B to 2**(B+1)-1 cycles, with bucket 0
+   also counting zero. */
+#define LATENCY_BUCKETS 32
+static uint32_t wake_latency[PRI_CNT][LATENCY_BUCKETS];
+
+/* Pages of threads that have exited, kept for reuse by
+   thread_create() instead of being returned to palloc, until the
+   cache is turned off or the kernel pool runs out.  Each is
+   linked through the dead thread's `elem'.  Only touched with
+   interrupts off. */
+static struct list thread_page_cache;
+static size_t thread_page_cache_cnt;
+#define THREAD_PAGE_CACHE_MAX 32        /* Most pages to keep. */
+
+/* If true (default), recycle the pages of exited threads.  The
+   spawn benchmark turns it off to measure the difference. */
+bool thread_page_cache_enabled = true;
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
@@ -62,6 +95,78 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler state.  Only the running
+   thread's recent_cpu changes from one tick to the next, so
+   instead of recomputing every thread's priority every fourth
+   tick, threads whose recent_cpu has changed are collected on
+   mlfqs_stale_list and only those are recomputed.  Once a second
+   every thread's recent_cpu decays, and then all are updated. */
+#define PRI_UPDATE_FREQ 4       /* # of ticks between priority updates. */
+static fixed_t load_avg;        /* System load average. */
+static struct list mlfqs_stale_list;
+
+/* If true, use the completely fair scheduler instead of the
+   priority scheduler.  Controlled by kernel command-line option
+   "-cfs".  Thread priorities are still tracked but no longer
+   decide which thread runs. */
+bool thread_cfs;
+
+/* Completely fair scheduler state.  Each thread's vruntime is
+   the CPU time it has received, scaled down by its weight, which
+   is derived from its nice value.  Ready threads are kept in
+   cfs_queue ordered by vruntime, and the one that is furthest
+   behind runs next.  The running thread is not in the queue.
+
+   cfs_min_vruntime never decreases.  It follows the smallest
+   vruntime among the running and ready threads, and is where new
+   and woken threads are placed, so that a thread that has been
+   away for a long time cannot monopolize the CPU to catch up. */
+#define CFS_VTICK 1024          /* vruntime of one tick at nice 0. */
+#define CFS_LATENCY 8           /* Ticks in which every thread should run. */
+#define CFS_MIN_GRANULARITY 1   /* Shortest time slice, in ticks. */
+#define CFS_WAKEUP_GRANULARITY CFS_VTICK   /* Lead needed to preempt. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_VTICK / 2)
+static struct rb_tree cfs_queue;
+static uint64_t cfs_min_vruntime;
+static unsigned long cfs_load;  /* Sum of the weights in cfs_queue. */
+
+/* Earliest-deadline-first scheduling class.  A thread that calls
+   thread_set_deadline() is guaranteed RUNTIME ticks of CPU time
+   in every PERIOD ticks, delivered within DEADLINE ticks of the
+   start of the period.  Ready EDF threads are kept in edf_queue
+   by absolute deadline and always run before any other thread.
+   A thread that uses up its runtime is throttled: it is parked on
+   edf_throttled_list, ordered by the start of its next period,
+   until thread_tick() replenishes its budget.
+
+   Admission control keeps the sum of RUNTIME / PERIOD over all
+   EDF threads, in units of EDF_BW_UNIT, at or below EDF_MAX_BW,
+   so that the reservations can be met and other threads keep
+   some of the CPU. */
+#define EDF_BW_UNIT (1 << 20)                   /* 100% utilization. */
+#define EDF_MAX_BW (EDF_BW_UNIT / 20 * 19)      /* 95% utilization. */
+static struct rb_tree edf_queue;
+static struct list edf_throttled_list;
+static uint32_t edf_total_bw;
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Nice 0
+   has weight 1024 and each step changes the weight by about 25%,
+   so that a thread gets about 10% more or less CPU time than a
+   competitor one nice level away. */
+#define NICE_0_WEIGHT 1024
+static const int cfs_weights[NICE_MAX - NICE_MIN + 1] =
+  {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+  };
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -73,6 +178,32 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
+static void schedstat_switch_out (struct thread *);
+static void schedstat_switch_in (struct thread *);
+static void schedstat_print (void);
+static int ready_max_priority (void);
+static void ready_remove (struct thread *);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void mlfqs_tick (struct thread *cur);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void mlfqs_update_thread (struct thread *, void *aux);
+static bool should_preempt (const struct thread *);
+static bool cfs_less (const struct rb_node *, const struct rb_node *,
+                      void *aux);
+static bool cfs_tick (struct thread *cur);
+static void cfs_place (struct thread *);
+static void cfs_update_min_vruntime (const struct thread *);
+static bool edf_less (const struct rb_node *, const struct rb_node *,
+                      void *aux);
+static int64_t edf_next_period (const struct thread *);
+static bool edf_next_period_less (const struct list_elem *,
+                                  const struct list_elem *, void *aux);
+static void edf_wakeup (struct thread *);
+static void edf_replenish (int64_t now);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -90,18 +221,24 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
+  list_init (&thread_page_cache);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
   list_init (&all_list);
   list_init (&sleep_list);
+  list_init (&mlfqs_stale_list);
+  rb_init (&cfs_queue, cfs_less, NULL);
+  rb_init (&edf_queue, edf_less, NULL);
+  list_init (&edf_throttled_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
-  list_remove(&initial_thread->elem);
-  //unblock(&initial_thread);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
 }
@@ -139,36 +276,46 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
-  
 
-  //This is hella ghetto and not working the way it should
-  struct list_elem *e;
-  //If we remove the element e, list_next(e) will not return
-  //the proper value. Here we save the next into e_next
-  //to allow the program to always hit the next thread.
-  struct list_elem *e_next;
-  int count = 0;
-  for (e = list_begin (&sleep_list); e != list_end (&sleep_list);
-       e = e_next)
-    {
-      e_next = list_next(e);
-      count++;
-      struct thread *t = list_entry (e, struct thread,elem);
-      ASSERT (t->status == THREAD_BLOCKED);
-      if(t->time_sleep > 0)
-      {
-	//printf("Counting down: %i\n", t->time_sleep);
-	t->time_sleep--;
-      }
-      else
-      {
-	//printf("\n\n\nI awaken. I am %s.\n\n\n", t->name);
-	thread_unblock(t);
-        //printf("Unblocked %s with %i ticks\n",t->name, t->ticks);
-      }
-  }
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (thread_mlfqs)
+    mlfqs_tick (cur_thread);
+
+  /* Wake every sleeper whose deadline has arrived. */
+  if (!list_empty (&sleep_list))
+    {
+      int64_t now = timer_ticks ();
+      while (!list_empty (&sleep_list))
+        {
+          struct thread *t = list_entry (list_front (&sleep_list),
+                                         struct thread, elem);
+          if (t->wakeup_tick > now)
+            break;
+          list_pop_front (&sleep_list);
+          thread_unblock (t);
+        }
+    }
+
+  /* Start the next period of throttled EDF threads. */
+  if (!list_empty (&edf_throttled_list))
+    edf_replenish (timer_ticks ());
+
+  /* Enforce preemption.  An EDF thread runs until it blocks,
+     exhausts its runtime, or a thread with an earlier deadline
+     wakes up. */
+  if (cur_thread->edf)
+    {
+      if (--cur_thread->edf_budget <= 0)
+        {
+          cur_thread->edf_throttled = true;
+          intr_yield_on_return ();
+        }
+    }
+  else if (thread_cfs)
+    {
+      if (cfs_tick (cur_thread))
+        intr_yield_on_return ();
+    }
+  else if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
@@ -178,6 +325,7 @@ thread_print_stats (void)
 {
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  schedstat_print ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -209,7 +357,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -237,6 +385,9 @@ thread_create (const char *name, int priority,
   sf->eip = switch_entry;
   sf->ebp = 0;
 
+  /* A new thread starts even with the threads already running. */
+  t->vruntime = cfs_min_vruntime;
+
   intr_set_level (old_level);
 
   /* Add to run queue. */
@@ -244,7 +395,7 @@ thread_create (const char *name, int priority,
   
 
   //if the thread has a higher priority.....
-  if(t->priority > thread_current()->priority)
+  if (should_preempt (t))
   {
       thread_yield();
   }
@@ -289,33 +440,82 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_remove (&t->elem);
-  thread_queue_ready(t);
+  if (t->edf)
+    edf_wakeup (t);
+  else if (thread_cfs)
+    cfs_place (t);
+  thread_queue_ready (t);
   t->status = THREAD_READY;
+  if (schedstat_enabled)
+    {
+      t->sched_stamp = rdtsc ();
+      t->sched_woken = true;
+    }
 
-  //if unblock thread greater priority than current thread....
-  if(t->priority > thread_current()->priority)
-  {
-      //thread_yield();
-  }
+  /* A thread woken from an interrupt handler preempts the
+     interrupted thread if it has higher priority.  Outside
+     interrupt context the caller decides when to yield. */
+  if (intr_context () && should_preempt (t))
+    intr_yield_on_return ();
   intr_set_level (old_level);
 
 }
 
+/* Puts the current thread to sleep until the timer reaches
+   WAKEUP_TICK, as returned by timer_ticks().  The sleep list is
+   kept sorted by deadline, with ties in FIFO order, so that
+   thread_tick() only needs to examine its front.
+
+   This function must be called with interrupts turned off. */
 void
-thread_sleep (void)
+thread_sleep (int64_t wakeup_tick)
 {
-  ASSERT(!intr_context ());
-  ASSERT(intr_get_level () == INTR_OFF);
-  struct thread *t = thread_current();
-  t->status = THREAD_BLOCKED;
+  struct thread *t = thread_current ();
 
-  if(t != idle_thread)
-  {
-    list_push_back(&sleep_list, &t->elem);
-  }
-  schedule();
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t != idle_thread);
+
+  t->wakeup_tick = wakeup_tick;
+  list_insert_ordered (&sleep_list, &t->elem, wakeup_less, NULL);
+  thread_block ();
+}
+
+/* Returns the tick at which the earliest sleeping thread must
+   wake up or the earliest throttled EDF thread must be
+   replenished, or INT64_MAX if there is none.  Must be called
+   with interrupts off. */
+int64_t
+thread_next_wakeup (void)
+{
+  int64_t next = INT64_MAX;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!list_empty (&sleep_list))
+    next = list_entry (list_front (&sleep_list), struct thread,
+                       elem)->wakeup_tick;
+  if (!list_empty (&edf_throttled_list))
+    {
+      int64_t period = edf_next_period (
+        list_entry (list_front (&edf_throttled_list), struct thread, elem));
+      if (period < next)
+        next = period;
+    }
+  return next;
 }
+
+/* Returns true if sleeping thread A should wake before B. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) 
@@ -364,6 +564,10 @@ thread_exit (void)
      when it calls thread_schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current()->allelem);
+  if (thread_current ()->edf)
+    edf_total_bw -= thread_current ()->edf_bw;
+  if (thread_current ()->mlfqs_stale)
+    list_remove (&thread_current ()->staleelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -387,6 +591,18 @@ thread_yield (void)
   intr_set_level (old_level);
 }
 
+/* Yields the CPU because an interrupt handler asked for it,
+   for example when the running thread's time slice expired or a
+   higher-priority thread was woken.  Called by the interrupt
+   code in place of thread_yield(), so that -schedstat can count
+   the switch as involuntary. */
+void
+thread_preempt (void) 
+{
+  thread_current ()->sched_preempted = true;
+  thread_yield ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -400,7 +616,7 @@ thread_foreach (thread_action_func *func, void *aux)
   for (e = list_begin (&all_list); e != list_end (&all_list);
        e = list_next (e))
     {
-      struct thread *t = list_entry (e, struct thread, elem);
+      struct thread *t = list_entry (e, struct thread, allelem);
       func (t, aux);
     }
 }
@@ -409,83 +625,87 @@ thread_foreach (thread_action_func *func, void *aux)
 void
 thread_set_priority (int new_priority) 
 {
-    enum intr_level old_level = intr_disable ();
-    int old_priority = thread_current()->priority;
-    thread_current()->initial_priority = new_priority;
-  thread_current ()->priority = new_priority;
-  //try to donate new priority
-  if(old_priority < new_priority)
-  {
-  	struct thread *current_thread = thread_current();
-	struct lock* current_lock = thread_current()->waiting_lock;
-	
-	int depth = 0;
-	while(current_lock && depth < 8)
-	{
-	    depth++;
-	    if(!current_lock->holder)
-		break;
-	    if(current_lock->holder->priority < current_thread->priority)
-	    {
-		//current_thread->donated_priority = true;
-		current_lock->holder->priority = current_thread->priority;
-		current_thread = current_lock->holder;
-		current_lock = current_thread->waiting_lock;
-		
-	    }
-	}
-  }
-  
-  //make sure we swap threads if the priority got lowered too much
-//BUT FIRST MAKE SURE THAT IFTHIS THREAD IS HOLDING A LOCK
-  //THE DONATORS DONATE
-  if(!list_empty(&thread_current()->donaters))
-      {
-	  struct list_elem *e;
-	  e = list_begin(&thread_current()->donaters);
-	  struct thread *t = list_entry(e, struct thread, donateelem);
-	  if(t->priority > thread_current()->priority)
-	      thread_current()->priority = t->priority;
-      }
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
+  /* The MLFQS computes priorities itself. */
+  if (thread_mlfqs)
+    return;
 
-    if (list_empty (&ready_list))
-    {
-	if(idle_thread->priority > new_priority)
-	{
-	    thread_yield();
-	}
-    }
-    else
-    {
-      //dont pop off the front of the list
-      //do a priority queue
-      //try a real quick ghetto one first
+  /* The running thread waits on no lock, so there is no chain to
+     donate along; priorities donated to it still apply. */
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_recompute_priority (cur);
 
-      struct list_elem *e = list_front(&ready_list);
-      struct thread *ret = list_entry(e, struct thread, elem);
-      int max_priority = ret->priority;
-      
-      for (e = list_begin (&ready_list); e != list_end (&ready_list);
-	   e = list_next (e))
-      {
+  /* Yield if a ready thread now outranks us.  Under -cfs
+     priorities do not decide who runs. */
+  if (!thread_cfs && ready_max_priority () > cur->priority)
+    thread_yield ();
 
-	  struct thread *t = list_entry (e, struct thread, elem);
-	  if(t->priority < max_priority)
-	  {
-	      ret = t;
-	      max_priority = ret->priority;
-	  }
-      }
+  intr_set_level (old_level);
+}
+
+/* Puts the current thread in the earliest-deadline-first class,
+   reserving RUNTIME ticks of CPU time in every PERIOD ticks, to
+   be delivered within DEADLINE ticks of the start of each
+   period.  The first period starts now.  Returns false, without
+   changing anything, if the parameters are invalid or admitting
+   the thread would reserve more than EDF_MAX_BW of the CPU.
+
+   A RUNTIME of 0 takes the current thread out of the EDF class
+   and always succeeds.  An EDF thread's reservation is also
+   released when it exits.  Threads created by an EDF thread are
+   not themselves in the EDF class. */
+bool
+thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  uint32_t bw = 0;
+
+  if (runtime != 0)
+    {
+      if (runtime < 0 || runtime > deadline || deadline > period)
+        return false;
+      bw = runtime * EDF_BW_UNIT / period;
+    }
 
-      if(max_priority > new_priority)
-      {
+  old_level = intr_disable ();
+  if (edf_total_bw - cur->edf_bw + bw > EDF_MAX_BW)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  edf_total_bw = edf_total_bw - cur->edf_bw + bw;
+  cur->edf_bw = bw;
 
-	  thread_yield();
-      }
+  if (runtime != 0)
+    {
+      cur->edf = true;
+      cur->edf_runtime = runtime;
+      cur->edf_deadline = deadline;
+      cur->edf_period = period;
+      cur->edf_abs_deadline = timer_ticks () + deadline;
+      cur->edf_budget = runtime;
     }
+  else if (cur->edf)
+    {
+      /* Rejoin the CFS no further ahead than the threads that
+         were left behind. */
+      cur->edf = false;
+      if (cur->vruntime < cfs_min_vruntime)
+        cur->vruntime = cfs_min_vruntime;
+    }
+
+  /* Let an EDF thread with an earlier deadline, or a
+     higher-priority thread we no longer outrank, run. */
+  if (!rb_empty (&edf_queue)
+      || (!cur->edf && !thread_cfs && ready_max_priority () > cur->priority))
+    thread_yield ();
 
-    intr_set_level(old_level);
+  intr_set_level (old_level);
+  return true;
 }
 
 /* Returns the current thread's priority. */
@@ -495,35 +715,317 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest.  Under
+   -cfs the new weight applies from the next timer tick. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    {
+      mlfqs_update_priority (cur);
+      if (ready_max_priority () > cur->priority)
+        thread_yield ();
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent;
+}
+
+/* Does the MLFQS bookkeeping for a timer tick while CUR is
+   running.  Runs in an external interrupt context. */
+static void
+mlfqs_tick (struct thread *cur) 
+{
+  int64_t ticks = timer_ticks ();
+
+  /* Charge the tick to the running thread and remember that its
+     priority needs recomputing. */
+  if (cur != idle_thread)
+    {
+      cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+      if (!cur->mlfqs_stale)
+        {
+          cur->mlfqs_stale = true;
+          list_push_back (&mlfqs_stale_list, &cur->staleelem);
+        }
+    }
+
+  /* Once a second, update the load average and decay every
+     thread's recent_cpu, which also refreshes every priority. */
+  if (ticks % TIMER_FREQ == 0)
+    {
+      int ready_threads = ready_cnt + (cur != idle_thread ? 1 : 0);
+      load_avg = fp_mul (fp_div (fp_from_int (59), fp_from_int (60)),
+                         load_avg)
+                 + fp_from_int (ready_threads) / 60;
+      thread_foreach (mlfqs_update_thread, NULL);
+    }
+
+  /* Every fourth tick, recompute the priorities that may have
+     changed since the last time. */
+  if (ticks % PRI_UPDATE_FREQ == 0)
+    {
+      while (!list_empty (&mlfqs_stale_list))
+        {
+          struct list_elem *e = list_pop_front (&mlfqs_stale_list);
+          struct thread *t = list_entry (e, struct thread, staleelem);
+          t->mlfqs_stale = false;
+          mlfqs_update_priority (t);
+        }
+      if (ready_max_priority () > cur->priority)
+        intr_yield_on_return ();
+    }
+}
+
+/* Returns the priority that the MLFQS assigns T based on its
+   recent_cpu and nice values. */
+static int
+mlfqs_priority (const struct thread *t) 
+{
+  int priority = PRI_MAX - fp_round (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  else if (priority > PRI_MAX)
+    return PRI_MAX;
+  else
+    return priority;
+}
+
+/* Recomputes T's priority, moving it to its new run queue if it
+   is ready. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  if (t != idle_thread)
+    thread_update_priority (t, mlfqs_priority (t));
+}
+
+/* Decays T's recent_cpu by the load average and recomputes its
+   priority.  Called once a second for every thread. */
+static void
+mlfqs_update_thread (struct thread *t, void *aux UNUSED) 
+{
+  fixed_t twice_load = load_avg * 2;
+  fixed_t coeff = fp_div (twice_load, fp_add_int (twice_load, 1));
+
+  if (t == idle_thread)
+    return;
+
+  t->recent_cpu = fp_add_int (fp_mul (coeff, t->recent_cpu), t->nice);
+  if (t->mlfqs_stale)
+    {
+      list_remove (&t->staleelem);
+      t->mlfqs_stale = false;
+    }
+  mlfqs_update_priority (t);
+}
+
+/* Returns true if T, which has just become ready, should
+   preempt the running thread.  EDF threads preempt all other
+   threads and EDF threads with later deadlines.  Otherwise, under
+   -cfs T preempts if it is at least CFS_WAKEUP_GRANULARITY
+   further behind in vruntime, and under the other schedulers if
+   it has higher priority. */
+static bool
+should_preempt (const struct thread *t) 
+{
+  struct thread *cur = running_thread ();
+
+  if (t->edf)
+    return !cur->edf || t->edf_abs_deadline < cur->edf_abs_deadline;
+  if (cur->edf)
+    return false;
+  if (thread_cfs)
+    return (cur == idle_thread
+            || t->vruntime + CFS_WAKEUP_GRANULARITY < cur->vruntime);
+  return t->priority > cur->priority;
+}
+
+/* Returns true if completely fair scheduler run queue element A
+   has less vruntime than B, false otherwise. */
+static bool
+cfs_less (const struct rb_node *a_, const struct rb_node *b_,
+          void *aux UNUSED) 
+{
+  const struct thread *a = rb_entry (a_, struct thread, cfs_node);
+  const struct thread *b = rb_entry (b_, struct thread, cfs_node);
+
+  return a->vruntime < b->vruntime;
+}
+
+/* Charges a timer tick to CUR, the running thread, and returns
+   true if CUR has used up its time slice and another thread is
+   waiting.  A slice is CUR's share, by weight, of the period in
+   which every runnable thread should get to run, which is
+   CFS_LATENCY ticks unless so many threads are runnable that
+   each would get less than CFS_MIN_GRANULARITY. */
+static bool
+cfs_tick (struct thread *cur) 
+{
+  unsigned weight, period, slice, nr_running;
+
+  if (cur == idle_thread)
+    return false;
+
+  weight = cfs_weights[cur->nice - NICE_MIN];
+  cur->vruntime += CFS_VTICK * NICE_0_WEIGHT / weight;
+  cfs_update_min_vruntime (cur);
+  thread_ticks++;
+  if (rb_empty (&cfs_queue))
+    return false;
+
+  nr_running = ready_cnt + 1;
+  period = CFS_LATENCY;
+  if (nr_running * CFS_MIN_GRANULARITY > period)
+    period = nr_running * CFS_MIN_GRANULARITY;
+  slice = period * weight / (cfs_load + weight);
+  if (slice < CFS_MIN_GRANULARITY)
+    slice = CFS_MIN_GRANULARITY;
+  return thread_ticks >= slice;
+}
+
+/* Places T, which is about to become ready, in virtual time.  A
+   thread that slept keeps its vruntime, and so its claim to the
+   CPU, but only up to CFS_SLEEPER_CREDIT behind min_vruntime. */
+static void
+cfs_place (struct thread *t) 
+{
+  uint64_t floor = 0;
+
+  if (cfs_min_vruntime > CFS_SLEEPER_CREDIT)
+    floor = cfs_min_vruntime - CFS_SLEEPER_CREDIT;
+  if (t->vruntime < floor)
+    t->vruntime = floor;
+}
+
+/* Advances cfs_min_vruntime to the smaller of the vruntimes of
+   CUR, the running or about-to-run thread, and the first thread
+   in cfs_queue, if that is larger. */
+static void
+cfs_update_min_vruntime (const struct thread *cur) 
+{
+  uint64_t vruntime = cur->vruntime;
+
+  if (!rb_empty (&cfs_queue))
+    {
+      const struct thread *first = rb_entry (rb_min (&cfs_queue),
+                                             struct thread, cfs_node);
+      if (first->vruntime < vruntime)
+        vruntime = first->vruntime;
+    }
+  if (vruntime > cfs_min_vruntime)
+    cfs_min_vruntime = vruntime;
+}
+
+/* Returns true if EDF run queue element A has an earlier
+   deadline than B, false otherwise. */
+static bool
+edf_less (const struct rb_node *a_, const struct rb_node *b_,
+          void *aux UNUSED) 
+{
+  const struct thread *a = rb_entry (a_, struct thread, edf_node);
+  const struct thread *b = rb_entry (b_, struct thread, edf_node);
+
+  return a->edf_abs_deadline < b->edf_abs_deadline;
+}
+
+/* Returns the tick at which EDF thread T's next period starts. */
+static int64_t
+edf_next_period (const struct thread *t) 
+{
+  return t->edf_abs_deadline - t->edf_deadline + t->edf_period;
+}
+
+/* Returns true if throttled EDF thread A's next period starts
+   before B's, false otherwise. */
+static bool
+edf_next_period_less (const struct list_elem *a_,
+                      const struct list_elem *b_, void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return edf_next_period (a) < edf_next_period (b);
+}
+
+/* Called when EDF thread T wakes up.  If T could not use the rest
+   of its budget by its current deadline without exceeding its
+   reserved utilization, it starts a new period now instead, so
+   that a thread that sleeps cannot save up runtime and overrun
+   its reservation later. */
+static void
+edf_wakeup (struct thread *t) 
+{
+  int64_t now = timer_ticks ();
+
+  ASSERT (!t->edf_throttled);
+
+  if (t->edf_abs_deadline <= now
+      || (t->edf_budget * t->edf_period
+          > t->edf_runtime * (t->edf_abs_deadline - now)))
+    {
+      t->edf_abs_deadline = now + t->edf_deadline;
+      t->edf_budget = t->edf_runtime;
+    }
+}
+
+/* Replenishes the runtime of each throttled EDF thread whose next
+   period has started by NOW, and makes it ready.  Runs in an
+   external interrupt context. */
+static void
+edf_replenish (int64_t now) 
+{
+  while (!list_empty (&edf_throttled_list))
+    {
+      struct thread *t = list_entry (list_front (&edf_throttled_list),
+                                     struct thread, elem);
+      if (edf_next_period (t) > now)
+        break;
+      list_pop_front (&edf_throttled_list);
+
+      t->edf_throttled = false;
+      t->edf_abs_deadline += t->edf_period;
+      if (t->edf_abs_deadline <= now)
+        t->edf_abs_deadline = now + t->edf_deadline;
+      t->edf_budget = t->edf_runtime;
+      thread_queue_ready (t);
+      if (should_preempt (t))
+        intr_yield_on_return ();
+    }
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -547,6 +1049,18 @@ idle (void *idle_started_ UNUSED)
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
+
+      /* Zero a free page so that a later PAL_ZERO allocation
+         need not, then look for a thread to run again.  The
+         page is zeroed with interrupts on, so the idle thread
+         may be preempted meanwhile, as in `sti; hlt' below. */
+      if (palloc_zero_idle ())
+        continue;
+
+      /* In tickless mode, stop the periodic timer interrupt
+         until the next sleeping thread has to wake up. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -610,12 +1124,25 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
-  t->time_sleep = 0;
-  t->waiting_lock = 0;
-  t->initial_priority = priority;
-  t->donated_priority = false;
-  list_init(&t->donaters);
-  list_push_back (&sleep_list,&t->elem);
+  t->base_priority = priority;
+  list_init (&t->held_locks);
+  if (schedstat_enabled)
+    t->sched_stamp = rdtsc ();
+
+  /* Under the MLFQS or CFS a new thread inherits its creator's
+     nice and recent_cpu values.  The MLFQS computes its priority
+     from them. */
+  if (thread_mlfqs || thread_cfs)
+    {
+      struct thread *parent = running_thread ();
+      if (parent != t && is_thread (parent))
+        {
+          t->nice = parent->nice;
+          t->recent_cpu = parent->recent_cpu;
+        }
+    }
+  if (thread_mlfqs)
+    t->priority = t->base_priority = mlfqs_priority (t);
   list_push_back (&all_list, &t->allelem);
 }
 
@@ -640,31 +1167,34 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-    if (list_empty (&ready_list))
+  int priority = ready_max_priority ();
+  struct thread *t;
+
+  if (!rb_empty (&edf_queue))
     {
-      return idle_thread;
+      t = rb_entry (rb_min (&edf_queue), struct thread, edf_node);
+      ready_remove (t);
+      return t;
     }
-    else
-    {
-      struct list_elem *e = list_front(&ready_list);
-      struct thread *ret = list_entry(e, struct thread, elem);
-      int max_priority = ret->priority;
-      
-      for (e = list_begin (&ready_list); e != list_end (&ready_list);
-	   e = list_next (e))
-      {
 
-	  struct thread *t = list_entry (e, struct thread, elem);
-	  if(t->priority > max_priority)
-	  {
-	      ret = t;
-	      max_priority = ret->priority;
-	  }
-      }
-      list_remove(&ret->elem);
-      return ret;
-	//return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  if (thread_cfs)
+    {
+      struct rb_node *n = rb_min (&cfs_queue);
+      if (n == NULL)
+        return idle_thread;
+      t = rb_entry (n, struct thread, cfs_node);
+      ready_remove (t);
+      cfs_update_min_vruntime (t);
+      return t;
     }
+
+  if (priority < PRI_MIN)
+    return idle_thread;
+
+  t = list_entry (list_front (&ready_queues[priority - PRI_MIN]),
+                  struct thread, elem);
+  ready_remove (t);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -690,8 +1220,11 @@ thread_schedule_tail (struct thread *prev)
   
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Mark us as running. */
+  /* Mark us as running.  PREV is null if schedule() found no
+     other thread to run, which is not a switch. */
   cur->status = THREAD_RUNNING;
+  if (schedstat_enabled && prev != NULL)
+    schedstat_switch_in (cur);
 
   /* Start new time slice. */
   thread_ticks = 0;
@@ -709,10 +1242,80 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      free_thread_page (prev);
     }
 }
 
+/* Returns a page for a new thread, recycled from an exited
+   thread if one is cached, or a null pointer if none is
+   available.  The page is not zeroed: init_thread() clears
+   struct thread, and nothing depends on the rest of the stack
+   being zero. */
+static struct thread *
+alloc_thread_page (void) 
+{
+  enum intr_level old_level;
+  struct thread *t = NULL;
+
+  if (!thread_page_cache_enabled)
+    {
+      thread_page_cache_drain ();
+      return palloc_get_page (PAL_ZERO);
+    }
+
+  old_level = intr_disable ();
+  if (!list_empty (&thread_page_cache))
+    {
+      t = list_entry (list_pop_front (&thread_page_cache),
+                      struct thread, elem);
+      thread_page_cache_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Caches dead thread T's page for reuse, or returns it to palloc
+   if the cache is full.  Must be called with interrupts off. */
+static void
+free_thread_page (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_page_cache_enabled
+      && thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX)
+    {
+      list_push_front (&thread_page_cache, &t->elem);
+      thread_page_cache_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
+/* Returns every cached thread page to palloc, and returns the
+   number of pages returned.  Called when the cache is turned off
+   and by palloc when the kernel pool runs out. */
+size_t
+thread_page_cache_drain (void) 
+{
+  enum intr_level old_level;
+  size_t cnt = 0;
+
+  old_level = intr_disable ();
+  while (!list_empty (&thread_page_cache))
+    {
+      palloc_free_page (list_entry (list_pop_front (&thread_page_cache),
+                                    struct thread, elem));
+      cnt++;
+    }
+  thread_page_cache_cnt = 0;
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -734,22 +1337,116 @@ schedule (void)
 
   if (cur != next)
   {
+    if (schedstat_enabled)
+      schedstat_switch_out (cur);
     prev = switch_threads (cur, next);
   }
+  else
+    cur->sched_preempted = false;
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Accounts for running thread T, whose status has just changed
+   from running, being switched away from. */
+static void
+schedstat_switch_out (struct thread *t) 
+{
+  uint64_t now = rdtsc ();
+
+  t->sched.run_cycles += now - t->sched_stamp;
+  if (t->status == THREAD_READY && t->sched_preempted)
+    t->sched.involuntary++;
+  else
+    t->sched.voluntary++;
+  t->sched_preempted = false;
+
+  /* A thread that yields starts waiting to run right away. */
+  t->sched_stamp = now;
+  t->sched_woken = false;
+}
+
+/* Accounts for T being switched to after waiting to run, and
+   records its wake-up latency if it was woken up. */
+static void
+schedstat_switch_in (struct thread *t) 
+{
+  uint64_t now = rdtsc ();
+  uint64_t wait = now - t->sched_stamp;
+
+  t->sched.ready_cycles += wait;
+  if (wait > t->sched.max_ready_cycles)
+    t->sched.max_ready_cycles = wait;
+  t->sched.dispatches++;
+  if (t->sched_woken)
+    {
+      int bucket = 0;
+      while (bucket < LATENCY_BUCKETS - 1 && wait >> (bucket + 1) != 0)
+        bucket++;
+      wake_latency[t->priority][bucket]++;
+      t->sched_woken = false;
+    }
+  t->sched_stamp = now;
+}
+
+/* Prints T's scheduler statistics. */
+static void
+schedstat_print_thread (struct thread *t, void *aux UNUSED) 
+{
+  const struct schedstat *st = &t->sched;
+
+  printf ("%5d %-16s %14llu %14llu %12llu %8"PRIu32" %8"PRIu32" %8"PRIu32"\n",
+          t->tid, t->name, st->run_cycles, st->ready_cycles,
+          st->max_ready_cycles, st->dispatches, st->voluntary,
+          st->involuntary);
+}
+
+/* Prints the scheduler statistics of every thread and the
+   wake-up latency histogram, if -schedstat was given. */
+static void
+schedstat_print (void) 
+{
+  enum intr_level old_level;
+  int pri, b;
+
+  if (!schedstat_enabled)
+    return;
+
+  old_level = intr_disable ();
+  printf ("Schedstat (times in cycles):\n");
+  printf ("%5s %-16s %14s %14s %12s %8s %8s %8s\n", "tid", "name",
+          "run", "ready", "max ready", "switches", "vol", "invol");
+  thread_foreach (schedstat_print_thread, NULL);
+
+  printf ("Wake-up latency by priority (log2 cycles: count):\n");
+  for (pri = PRI_MAX; pri >= PRI_MIN; pri--)
+    {
+      bool any = false;
+
+      for (b = 0; b < LATENCY_BUCKETS; b++)
+        if (wake_latency[pri][b] != 0)
+          {
+            if (!any)
+              printf ("  pri %2d:", pri);
+            printf (" %d:%"PRIu32, b, wake_latency[pri][b]);
+            any = true;
+          }
+      if (any)
+        printf ("\n");
+    }
+  intr_set_level (old_level);
+}
+
+/* Returns a tid to use for a new thread.  A single locked
+   exchange-and-add makes this safe from any context and on any
+   CPU, without sleeping. */
 static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  tid_t tid = 1;
 
+  asm volatile ("lock xaddl %0, %1"
+                : "+r" (tid), "+m" (next_tid) : : "memory");
   return tid;
 }
 
@@ -757,10 +1454,140 @@ allocate_tid (void)
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
+/* Adds T to the back of the run queue for its priority, or
+   under -cfs to cfs_queue behind every thread with the same
+   vruntime.  An EDF thread goes into edf_queue instead, or if it
+   is throttled, onto edf_throttled_list, where it does not count
+   as ready. */
 void 
-thread_queue_ready(struct thread *t)
+thread_queue_ready (struct thread *t)
 {
+  int idx = t->priority - PRI_MIN;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
 
-      list_push_back(&ready_list, &t->elem);
+  if (t->edf && t->edf_throttled)
+    {
+      list_insert_ordered (&edf_throttled_list, &t->elem,
+                           edf_next_period_less, NULL);
+      return;
+    }
 
+  if (t->edf)
+    rb_insert (&edf_queue, &t->edf_node);
+  else if (thread_cfs)
+    {
+      rb_insert (&cfs_queue, &t->cfs_node);
+      cfs_load += cfs_weights[t->nice - NICE_MIN];
+    }
+  else
+    {
+      list_push_back (&ready_queues[idx], &t->elem);
+      ready_bitmap |= (uint64_t) 1 << idx;
+    }
+  ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void
+ready_remove (struct thread *t)
+{
+  int idx = t->priority - PRI_MIN;
+
+  if (t->edf && t->edf_throttled)
+    {
+      list_remove (&t->elem);
+      return;
+    }
+
+  if (t->edf)
+    rb_remove (&edf_queue, &t->edf_node);
+  else if (thread_cfs)
+    {
+      rb_remove (&cfs_queue, &t->cfs_node);
+      cfs_load -= cfs_weights[t->nice - NICE_MIN];
+    }
+  else
+    {
+      list_remove (&t->elem);
+      if (list_empty (&ready_queues[idx]))
+        ready_bitmap &= ~((uint64_t) 1 << idx);
+    }
+  ready_cnt--;
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   PRI_MIN - 1 if no thread is ready.  Scans the high word of
+   ready_bitmap first so that only 32-bit bit scans are needed.
+   Under -cfs the bitmap is not kept and this always returns
+   PRI_MIN - 1. */
+static int
+ready_max_priority (void)
+{
+  uint32_t hi = ready_bitmap >> 32;
+  uint32_t lo = ready_bitmap;
+
+  if (hi != 0)
+    return PRI_MIN + 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return PRI_MIN + 31 - __builtin_clz (lo);
+  else
+    return PRI_MIN - 1;
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities donated to the locks and rwlocks
+   it holds.
+   Must be called with interrupts off. */
+void
+thread_recompute_priority (struct thread *t) 
+{
+  int priority = t->base_priority;
+  struct list_elem *e;
+  int i;
+
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct lock *lock = list_entry (e, struct lock, holdelem);
+      if (lock->max_priority > priority)
+        priority = lock->max_priority;
+    }
+  for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+    {
+      struct rwlock *rw = t->rw_holds[i].rwlock;
+      if (rw != NULL && rw->max_priority > priority)
+        priority = rw->max_priority;
+    }
+  thread_update_priority (t, priority);
+}
+
+/* Changes T's effective priority to PRIORITY, for example when a
+   priority is donated to it.  If T is ready to run, it is moved
+   to the back of the run queue for its new priority; if it is
+   waiting on a semaphore or condition variable, it is moved
+   within that wait queue.  Must be called with interrupts off. */
+void
+thread_update_priority (struct thread *t, int priority)
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+
+  if (t->status == THREAD_READY)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      thread_queue_ready (t);
+    }
+  else
+    {
+      t->priority = priority;
+      if (t->status == THREAD_BLOCKED)
+        synch_requeue_waiter (t);
+    }
 }
@@ -3,7 +3,11 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <schedstat.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
+#include "threads/synch.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -24,6 +28,12 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler
+   and the completely fair scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -92,16 +102,54 @@ struct thread
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
-      struct list_elem donateelem;
-      struct list donaters;
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
 #endif
-      unsigned time_sleep;
-      struct lock* waiting_lock;
-      int initial_priority;
-      bool donated_priority;
+
+    /* Priority donation.  PRIORITY is the effective priority:
+       the maximum of BASE_PRIORITY and the max_priority of every
+       lock in HELD_LOCKS. */
+    int base_priority;                  /* Priority set by the thread. */
+    struct list held_locks;             /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being acquired, if any. */
+    struct rwlock_hold rw_holds[RWLOCK_HOLD_MAX]; /* Rwlocks held. */
+    struct rwlock *waiting_rwlock;      /* Rwlock being acquired, if any. */
+    int64_t wakeup_tick;                /* Tick to wake from timer_sleep(). */
+
+    /* Owned by synch.c. */
+    struct list *wait_list;             /* Priority-ordered wait queue. */
+    struct list_elem *wait_elem;        /* Our element in WAIT_LIST. */
+    list_less_func *wait_less;          /* Ordering of WAIT_LIST. */
+
+    /* Multi-level feedback queue scheduler state. */
+    int nice;                           /* Niceness. */
+    fixed_t recent_cpu;                 /* Recent CPU usage. */
+    bool mlfqs_stale;                   /* On mlfqs_stale_list? */
+    struct list_elem staleelem;         /* mlfqs_stale_list element. */
+
+    /* Completely fair scheduler state. */
+    struct rb_node cfs_node;            /* Run queue node, when ready. */
+    uint64_t vruntime;                  /* CPU time received, by weight. */
+
+    /* Earliest-deadline-first scheduling, set by
+       thread_set_deadline().  Times are in timer ticks. */
+    bool edf;                           /* In the EDF class? */
+    bool edf_throttled;                 /* Out of runtime until next period? */
+    int64_t edf_runtime;                /* Runtime per period. */
+    int64_t edf_deadline;               /* Deadline, from start of period. */
+    int64_t edf_period;                 /* Period. */
+    int64_t edf_abs_deadline;           /* Deadline of current period. */
+    int64_t edf_budget;                 /* Runtime left in current period. */
+    uint32_t edf_bw;                    /* Reserved utilization. */
+    struct rb_node edf_node;            /* edf_queue node, when ready. */
+
+    /* Scheduler statistics, kept with -schedstat. */
+    struct schedstat sched;             /* Accumulated statistics. */
+    uint64_t sched_stamp;               /* TSC when last run or readied. */
+    bool sched_woken;                   /* Readied by thread_unblock()? */
+    bool sched_preempted;               /* Yielding by preemption? */
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -111,17 +159,31 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
+/* If true, keep per-thread scheduler statistics.
+   Controlled by kernel command-line option "-schedstat". */
+extern bool schedstat_enabled;
+
+/* If true (default), recycle the pages of exited threads. */
+extern bool thread_page_cache_enabled;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+size_t thread_page_cache_drain (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_sleep (int64_t wakeup_tick);
+int64_t thread_next_wakeup (void);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -129,6 +191,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -137,11 +200,16 @@ void thread_foreach (thread_action_func *, void *);
 int thread_get_priority (void);
 void thread_set_priority (int);
 
+bool thread_set_deadline (int64_t runtime, int64_t deadline,
+                          int64_t period);
+
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-void thread_queue_ready(struct thread *);
+void thread_queue_ready (struct thread *);
+void thread_update_priority (struct thread *, int priority);
+void thread_recompute_priority (struct thread *);
 
 #endif /* threads/thread.h */
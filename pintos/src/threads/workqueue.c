@@ -0,0 +1,363 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+#include "devices/timer.h"
+
+/* Bound on the depth of system_wq. */
+#define SYSTEM_WQ_DEPTH 64
+
+/* Shared workqueue for work that needs no queue of its own. */
+struct workqueue system_wq;
+
+/* Number of worker threads for system_wq.
+   Controlled by kernel command-line option "-wq=N". */
+int workqueue_system_threads = 1;
+
+/* All workqueues, for workqueue_print_stats(). */
+static struct list all_workqueues = LIST_INITIALIZER (all_workqueues);
+
+/* Work items in the WORK_DELAYED state, ordered by run_tick.
+   Moved to their workqueues by workqueue_tick(). */
+static struct list delayed_list = LIST_INITIALIZER (delayed_list);
+
+static thread_func worker;
+
+/* Creates system_wq, if it is configured to have any threads.
+   Must be called after thread_start(). */
+void
+workqueue_init (void) 
+{
+  if (workqueue_system_threads > 0
+      && !workqueue_create (&system_wq, "events", workqueue_system_threads,
+                            PRI_DEFAULT, SYSTEM_WQ_DEPTH))
+    PANIC ("could not create system workqueue");
+}
+
+/* Initializes WQ, named NAME, to hold up to MAX_DEPTH items, and
+   starts THREAD_CNT worker threads for it at PRIORITY.  WQ is
+   never destroyed, so it must outlive the kernel.  Returns true
+   if successful, false if a thread could not be created, in
+   which case WQ runs with the threads that were. */
+bool
+workqueue_create (struct workqueue *wq, const char *name,
+                  int thread_cnt, int priority, size_t max_depth) 
+{
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (wq != NULL);
+  ASSERT (name != NULL);
+  ASSERT (thread_cnt > 0);
+  ASSERT (max_depth > 0);
+
+  wq->name = name;
+  list_init (&wq->items);
+  wq->depth = 0;
+  wq->max_depth = max_depth;
+  sema_init (&wq->pending, 0);
+  wq->thread_cnt = 0;
+  memset (&wq->stats, 0, sizeof wq->stats);
+
+  old_level = intr_disable ();
+  list_push_back (&all_workqueues, &wq->allelem);
+  intr_set_level (old_level);
+
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+        return false;
+      wq->thread_cnt++;
+    }
+  return true;
+}
+
+/* Initializes work item W to run FUNC at PRIORITY. */
+void
+work_init (struct work *w, work_func *func, int priority) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  w->func = func;
+  w->priority = priority;
+  w->state = WORK_IDLE;
+  w->wq = NULL;
+}
+
+/* Returns true if work item A has lower priority than B. */
+static bool
+work_less (const struct list_elem *a, const struct list_elem *b,
+           void *aux UNUSED) 
+{
+  return (list_entry (a, struct work, elem)->priority
+          < list_entry (b, struct work, elem)->priority);
+}
+
+/* Adds idle item W to WQ behind every queued item of equal or
+   higher priority, scanning from the back so that items of the
+   same priority queue in constant time.  Returns false if WQ is
+   full.  Must be called with interrupts off. */
+static bool
+enqueue (struct workqueue *wq, struct work *w) 
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (w->state == WORK_IDLE);
+
+  if (wq->depth >= wq->max_depth)
+    {
+      wq->stats.rejected++;
+      return false;
+    }
+
+  for (e = list_rbegin (&wq->items); e != list_rend (&wq->items);
+       e = list_prev (e))
+    if (!work_less (e, &w->elem, NULL))
+      break;
+  list_insert (list_next (e), &w->elem);
+
+  w->state = WORK_QUEUED;
+  w->wq = wq;
+  w->queued_at = rdtsc ();
+  wq->stats.queued++;
+  if (++wq->depth > wq->stats.max_depth)
+    wq->stats.max_depth = wq->depth;
+  sema_up (&wq->pending);
+  return true;
+}
+
+/* Queues W on WQ to be run by one of its workers as soon as
+   possible.  If W is already queued, the requests are merged; if
+   it is delayed, it is queued now instead.  Returns false if WQ
+   is full, true otherwise.
+
+   This function may be called from an interrupt handler. */
+bool
+workqueue_queue (struct workqueue *wq, struct work *w) 
+{
+  enum intr_level old_level;
+  bool success = true;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->state == WORK_QUEUED)
+    wq->stats.merged++;
+  else
+    {
+      if (w->state == WORK_DELAYED)
+        {
+          list_remove (&w->elem);
+          w->state = WORK_IDLE;
+          wq->stats.merged++;
+        }
+      success = enqueue (wq, w);
+    }
+  intr_set_level (old_level);
+
+  return success;
+}
+
+/* Returns true if delayed item A is due before B. */
+static bool
+run_tick_less (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED) 
+{
+  return (list_entry (a, struct work, elem)->run_tick
+          < list_entry (b, struct work, elem)->run_tick);
+}
+
+/* Queues W on WQ once TICKS timer ticks have passed.  If W is
+   already queued, or delayed until no later, the requests are
+   merged; if it is delayed until later, its delay is shortened.
+   Returns false if TICKS <= 0 and WQ is full, true otherwise; a
+   delayed item that finds WQ full when it comes due is dropped
+   and counted as rejected.
+
+   This function may be called from an interrupt handler. */
+bool
+workqueue_queue_delayed (struct workqueue *wq, struct work *w,
+                         int64_t ticks) 
+{
+  enum intr_level old_level;
+  int64_t run_tick;
+
+  ASSERT (wq != NULL);
+  ASSERT (w != NULL);
+
+  if (ticks <= 0)
+    return workqueue_queue (wq, w);
+
+  old_level = intr_disable ();
+  run_tick = timer_ticks () + ticks;
+  if (w->state == WORK_QUEUED
+      || (w->state == WORK_DELAYED && w->run_tick <= run_tick))
+    wq->stats.merged++;
+  else
+    {
+      if (w->state == WORK_DELAYED)
+        {
+          list_remove (&w->elem);
+          wq->stats.merged++;
+        }
+      w->state = WORK_DELAYED;
+      w->wq = wq;
+      w->run_tick = run_tick;
+      list_insert_ordered (&delayed_list, &w->elem, run_tick_less, NULL);
+    }
+  intr_set_level (old_level);
+
+  return true;
+}
+
+/* Removes W from the queue or delayed list it is in, so that it
+   will not run.  Returns true if W was pending, false if it was
+   idle.  An item whose function is already running is idle, so
+   this does not wait for it to finish. */
+bool
+workqueue_cancel (struct work *w) 
+{
+  enum intr_level old_level;
+  bool pending;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  pending = w->state != WORK_IDLE;
+  if (pending)
+    {
+      /* The worker that the item's sema_up() wakes finds one
+         item fewer and goes back to sleep. */
+      if (w->state == WORK_QUEUED)
+        w->wq->depth--;
+      list_remove (&w->elem);
+      w->state = WORK_IDLE;
+    }
+  intr_set_level (old_level);
+
+  return pending;
+}
+
+/* Copies WQ's statistics into *STATS. */
+void
+workqueue_get_stats (struct workqueue *wq, struct workqueue_stats *stats) 
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = wq->stats;
+  intr_set_level (old_level);
+}
+
+/* Called by the timer interrupt handler at tick NOW.  Queues the
+   delayed items that have come due. */
+void
+workqueue_tick (int64_t now) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&delayed_list)) 
+    {
+      struct work *w = list_entry (list_front (&delayed_list),
+                                   struct work, elem);
+      if (w->run_tick > now)
+        break;
+      list_pop_front (&delayed_list);
+      w->state = WORK_IDLE;
+      enqueue (w->wq, w);
+    }
+}
+
+/* Returns the tick at which the earliest delayed item comes due,
+   or INT64_MAX if there is none.  Must be called with interrupts
+   off. */
+int64_t
+workqueue_next_deadline (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (list_empty (&delayed_list))
+    return INT64_MAX;
+  return list_entry (list_front (&delayed_list), struct work,
+                     elem)->run_tick;
+}
+
+/* Prints statistics for every workqueue. */
+void
+workqueue_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_workqueues); e != list_end (&all_workqueues);
+       e = list_next (e))
+    {
+      struct workqueue *wq = list_entry (e, struct workqueue, allelem);
+      struct workqueue_stats st;
+
+      workqueue_get_stats (wq, &st);
+      printf ("Workqueue %s: %llu queued, %llu merged, %llu rejected, "
+              "%llu completed, max depth %zu, latency %llu avg, %llu max "
+              "cycles\n",
+              wq->name, st.queued, st.merged, st.rejected, st.completed,
+              st.max_depth, st.started ? st.latency_total / st.started : 0,
+              st.latency_max);
+    }
+}
+
+/* Worker thread for workqueue WQ_.  Runs queued items one at a
+   time, each at the item's priority, and waits for the next item
+   at the priority the workqueue was created with. */
+static void
+worker (void *wq_) 
+{
+  struct workqueue *wq = wq_;
+  int priority = thread_get_priority ();
+
+  for (;;) 
+    {
+      enum intr_level old_level;
+      struct work *w;
+      work_func *func;
+      uint64_t latency;
+
+      sema_down (&wq->pending);
+
+      old_level = intr_disable ();
+      if (list_empty (&wq->items))
+        {
+          /* The item was cancelled. */
+          intr_set_level (old_level);
+          continue;
+        }
+      w = list_entry (list_pop_front (&wq->items), struct work, elem);
+      wq->depth--;
+      w->state = WORK_IDLE;
+      func = w->func;
+      latency = rdtsc () - w->queued_at;
+      wq->stats.started++;
+      wq->stats.latency_total += latency;
+      if (latency > wq->stats.latency_max)
+        wq->stats.latency_max = latency;
+      intr_set_level (old_level);
+
+      /* W may be requeued or freed by FUNC, so it is not touched
+         after the call. */
+      if (!thread_mlfqs)
+        thread_set_priority (w->priority);
+      func (w);
+      if (!thread_mlfqs)
+        thread_set_priority (priority);
+
+      old_level = intr_disable ();
+      wq->stats.completed++;
+      intr_set_level (old_level);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+struct work;
+typedef void work_func (struct work *);
+
+/* States of a work item. */
+enum work_state
+  {
+    WORK_IDLE,          /* Not queued; may be queued. */
+    WORK_QUEUED,        /* Waiting in a workqueue for a worker. */
+    WORK_DELAYED        /* Waiting for its tick to be queued. */
+  };
+
+/* A unit of deferred work.  Embed it in a larger structure and
+   use list_entry()-style arithmetic in FUNC to get back to it.
+   An item is in at most one queue at a time: queuing an item
+   that is already queued or delayed merges with the pending
+   request instead of running FUNC twice.  FUNC may queue its own
+   item again. */
+struct work
+  {
+    struct list_elem elem;      /* Element in queue or delayed list. */
+    work_func *func;            /* Function to run. */
+    int priority;               /* Priority to run FUNC at. */
+    enum work_state state;      /* Current state. */
+    struct workqueue *wq;       /* Queue it is in or will be put in. */
+    int64_t run_tick;           /* When WORK_DELAYED, tick to queue it. */
+    uint64_t queued_at;         /* TSC when it was queued. */
+  };
+
+/* Workqueue statistics.  Latencies are in TSC cycles, from
+   queuing an item until a worker starts running it. */
+struct workqueue_stats
+  {
+    uint64_t queued;            /* Items queued. */
+    uint64_t merged;            /* Requests merged with a pending item. */
+    uint64_t rejected;          /* Requests refused because full. */
+    uint64_t started;           /* Items a worker started running. */
+    uint64_t completed;         /* Items run to completion. */
+    size_t max_depth;           /* Most items ever queued at once. */
+    uint64_t latency_total;     /* Sum of latencies. */
+    uint64_t latency_max;       /* Longest latency. */
+  };
+
+/* A bounded queue of work items served by a pool of kernel
+   threads.  Items run in priority order, FIFO among equals. */
+struct workqueue
+  {
+    const char *name;           /* Name, for statistics. */
+    struct list items;          /* Queued items, by priority. */
+    size_t depth;               /* Number of queued items. */
+    size_t max_depth;           /* Bound on DEPTH. */
+    struct semaphore pending;   /* Upped once per queued item. */
+    int thread_cnt;             /* Number of worker threads. */
+    struct list_elem allelem;   /* Element in list of workqueues. */
+    struct workqueue_stats stats;
+  };
+
+/* Shared workqueue for work that needs no queue of its own. */
+extern struct workqueue system_wq;
+
+/* Number of worker threads for system_wq.
+   Controlled by kernel command-line option "-wq=N". */
+extern int workqueue_system_threads;
+
+void workqueue_init (void);
+bool workqueue_create (struct workqueue *, const char *name,
+                       int thread_cnt, int priority, size_t max_depth);
+void work_init (struct work *, work_func *, int priority);
+bool workqueue_queue (struct workqueue *, struct work *);
+bool workqueue_queue_delayed (struct workqueue *, struct work *,
+                              int64_t ticks);
+bool workqueue_cancel (struct work *);
+void workqueue_get_stats (struct workqueue *, struct workqueue_stats *);
+
+void workqueue_tick (int64_t now);
+int64_t workqueue_next_deadline (void);
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
@@ -1,8 +1,13 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <time.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 static void syscall_handler (struct intr_frame *);
 
@@ -12,9 +17,85 @@ syscall_init (void)
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* Returns true if the SIZE bytes at user address UADDR are all
+   mapped in the running process's address space and, if WRITE is
+   true, writable by it. */
+static bool
+user_range_ok (const void *uaddr, size_t size, bool write) 
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *p = pg_round_down (uaddr);
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  if (pd == NULL || size == 0 || end < (const uint8_t *) uaddr
+      || !is_user_vaddr (end - 1))
+    return false;
+  for (; p < end; p += PGSIZE)
+    if (write ? !pagedir_is_writable (pd, p)
+        : pagedir_get_page (pd, p) == NULL)
+      return false;
+  return true;
+}
+
+/* Copies the running thread's scheduler statistics to user
+   buffer ST.  Returns false if -schedstat is not in effect. */
+static bool
+sys_schedstat (struct schedstat *st) 
+{
+  if (!user_range_ok (st, sizeof *st, true))
+    thread_exit ();
+  if (!schedstat_enabled)
+    return false;
+  memcpy (st, &thread_current ()->sched, sizeof *st);
+  return true;
+}
+
+/* Stores the current time by CLOCK, one of the CLOCK_*
+   constants, into user buffer TS.  Returns false if CLOCK is not
+   a known clock. */
+static bool
+sys_clock_gettime (int clock, struct timespec *ts) 
+{
+  int64_t ns;
+
+  if (!user_range_ok (ts, sizeof *ts, true))
+    thread_exit ();
+  if (clock == CLOCK_MONOTONIC)
+    ns = timer_ns ();
+  else if (clock == CLOCK_REALTIME)
+    ns = timer_realtime_ns ();
+  else
+    return false;
+  ts->tv_sec = ns / 1000000000;
+  ts->tv_nsec = ns % 1000000000;
+  return true;
+}
+
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
-  printf ("system call!\n");
-  thread_exit ();
+  const int *args = f->esp;
+
+  /* The system call number and up to 3 arguments.  The wrappers
+     in lib/user/syscall.c push them inside their own stack
+     frames, with at least their return addresses above, so all 4
+     words are on the user stack even for calls that take fewer
+     arguments. */
+  if (!user_range_ok (args, 4 * sizeof *args, false))
+    thread_exit ();
+
+  switch (args[0]) 
+    {
+    case SYS_SCHEDSTAT:
+      f->eax = sys_schedstat ((struct schedstat *) args[1]);
+      break;
+
+    case SYS_CLOCK_GETTIME:
+      f->eax = sys_clock_gettime (args[1], (struct timespec *) args[2]);
+      break;
+
+    default:
+      printf ("system call!\n");
+      thread_exit ();
+    }
 }